@@ -0,0 +1,174 @@
+#ifndef BITBOARD_H
+#define BITBOARD_H
+
+#include <cstdint>
+
+// bit (x * 8 + y) is the square board[x][y]
+typedef uint64_t Bitboard;
+
+const Bitboard COL_0 = 0x0101010101010101ULL;
+const Bitboard COL_7 = 0x8080808080808080ULL;
+const Bitboard ROW_0 = 0x00000000000000FFULL;
+const Bitboard ROW_7 = 0xFF00000000000000ULL;
+const Bitboard BORDER = COL_0 | COL_7 | ROW_0 | ROW_7;
+const Bitboard CORNERS = 0x8100000000000081ULL;
+
+inline int bit_count(Bitboard b)
+{
+    return __builtin_popcountll(b);
+}
+
+// diagonal (x - y constant) and anti-diagonal (x + y constant) lines, 15 each
+struct DiagonalMasks
+{
+    Bitboard diag[15];
+    Bitboard anti[15];
+    DiagonalMasks() : diag(), anti()
+    {
+        for (int x = 0; x < 8; x++)
+        {
+            for (int y = 0; y < 8; y++)
+            {
+                diag[x - y + 7] |= 1ULL << (x * 8 + y);
+                anti[x + y] |= 1ULL << (x * 8 + y);
+            }
+        }
+    }
+};
+const DiagonalMasks Diagonal_Masks;
+
+// squares lying on completely filled lines, one mask per direction
+inline void get_full_lines(Bitboard occupied, Bitboard &full_h, Bitboard &full_v, Bitboard &full_d, Bitboard &full_a)
+{
+    full_h = full_v = full_d = full_a = 0;
+    Bitboard cols = occupied;
+    for (int i = 0; i < 8; i++)
+    {
+        Bitboard row = ROW_0 << (i * 8);
+        if ((occupied & row) == row)
+            full_h |= row;
+        cols &= occupied >> (i * 8) | ~ROW_0;
+    }
+    full_v = (cols & ROW_0) * COL_0;
+    for (int i = 0; i < 15; i++)
+    {
+        if ((occupied & Diagonal_Masks.diag[i]) == Diagonal_Masks.diag[i])
+            full_d |= Diagonal_Masks.diag[i];
+        if ((occupied & Diagonal_Masks.anti[i]) == Diagonal_Masks.anti[i])
+            full_a |= Diagonal_Masks.anti[i];
+    }
+}
+
+// Discs of `own` that can never be flipped. A disc is stable when, along each
+// of the 4 axes, its line is full or it touches the wall or a stable own disc.
+// Starting from the corners this propagates along the edges and inwards.
+inline Bitboard stable_discs(Bitboard own, Bitboard opp)
+{
+    Bitboard full_h, full_v, full_d, full_a;
+    get_full_lines(own | opp, full_h, full_v, full_d, full_a);
+    full_h |= COL_0 | COL_7;
+    full_v |= ROW_0 | ROW_7;
+    full_d |= BORDER;
+    full_a |= BORDER;
+
+    Bitboard stable = 0, old;
+    do
+    {
+        old = stable;
+        Bitboard h = ((stable << 1) & ~COL_0) | ((stable >> 1) & ~COL_7) | full_h;
+        Bitboard v = (stable << 8) | (stable >> 8) | full_v;
+        Bitboard d = ((stable << 9) & ~COL_0) | ((stable >> 9) & ~COL_7) | full_d;
+        Bitboard a = ((stable << 7) & ~COL_7) | ((stable >> 7) & ~COL_0) | full_a;
+        stable |= own & h & v & d & a;
+    } while (stable != old);
+    return stable;
+}
+
+// squares adjacent to any square of b
+inline Bitboard neighbor_squares(Bitboard b)
+{
+    return ((b << 1) & ~COL_0) | ((b >> 1) & ~COL_7) | (b << 8) | (b >> 8) |
+           ((b << 9) & ~COL_0) | ((b >> 9) & ~COL_7) | ((b << 7) & ~COL_7) | ((b >> 7) & ~COL_0);
+}
+
+// x -> 7 - x
+inline Bitboard flip_vertical(Bitboard b)
+{
+    return __builtin_bswap64(b);
+}
+
+// y -> 7 - y
+inline Bitboard mirror_horizontal(Bitboard b)
+{
+    b = ((b >> 1) & 0x5555555555555555ULL) | ((b & 0x5555555555555555ULL) << 1);
+    b = ((b >> 2) & 0x3333333333333333ULL) | ((b & 0x3333333333333333ULL) << 2);
+    b = ((b >> 4) & 0x0F0F0F0F0F0F0F0FULL) | ((b & 0x0F0F0F0F0F0F0F0FULL) << 4);
+    return b;
+}
+
+// x <-> y
+inline Bitboard transpose(Bitboard b)
+{
+    Bitboard t;
+    t = 0x0F0F0F0F00000000ULL & (b ^ (b << 28));
+    b ^= t ^ (t >> 28);
+    t = 0x3333000033330000ULL & (b ^ (b << 14));
+    b ^= t ^ (t >> 14);
+    t = 0x5500550055005500ULL & (b ^ (b << 7));
+    b ^= t ^ (t >> 7);
+    return b;
+}
+
+// The 8 board symmetries: bit 2 transposes, then bit 0 mirrors y, bit 1 flips x.
+inline Bitboard symmetry(Bitboard b, int sym)
+{
+    if (sym & 4)
+        b = transpose(b);
+    if (sym & 1)
+        b = mirror_horizontal(b);
+    if (sym & 2)
+        b = flip_vertical(b);
+    return b;
+}
+
+inline Bitboard inverse_symmetry(Bitboard b, int sym)
+{
+    if (sym & 2)
+        b = flip_vertical(b);
+    if (sym & 1)
+        b = mirror_horizontal(b);
+    if (sym & 4)
+        b = transpose(b);
+    return b;
+}
+
+inline int symmetry_square(int square, int sym)
+{
+    return __builtin_ctzll(symmetry(1ULL << square, sym));
+}
+
+inline int inverse_symmetry_square(int square, int sym)
+{
+    return __builtin_ctzll(inverse_symmetry(1ULL << square, sym));
+}
+
+// Replaces the position by its smallest orientation; sym maps the original onto it.
+inline void canonical(Bitboard &black, Bitboard &white, int &sym)
+{
+    Bitboard best_black = black, best_white = white;
+    sym = 0;
+    for (int s = 1; s < 8; s++)
+    {
+        Bitboard b = symmetry(black, s), w = symmetry(white, s);
+        if (b < best_black || (b == best_black && w < best_white))
+        {
+            best_black = b;
+            best_white = w;
+            sym = s;
+        }
+    }
+    black = best_black;
+    white = best_white;
+}
+
+#endif
@@ -0,0 +1,1810 @@
+#ifndef ENGINE_H
+#define ENGINE_H
+
+#include <iostream>
+#include <fstream>
+#include <array>
+#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <string>
+#include <unordered_map>
+#include <cctype>
+
+#include "bitboard.h"
+#include "transposition.h"
+#include "squares.h"
+#include "move_list.h"
+#include "time_manager.h"
+#include "nnue.h"
+#include "state.h"
+#include "score.h"
+#include "mcts.h"
+#include "scheduler.h"
+
+#define DEPTH 5
+#define PARITY_EMPTIES 14
+#define SOLVE_EMPTIES 20
+#define SOLVE_PROBE_DEPTH 6
+#define SPLIT_EMPTIES 12
+#define SOLVE_TABLE_BITS 20
+#define SOLVE_TABLE_EMPTIES 6
+#define SOLVE_FASTEST_EMPTIES 7
+#define TT_BITS 18 // 64-byte buckets, 7 entries each
+#define EVAL_CACHE_BITS 16
+#define LEAF_BATCH 1 // children per LeafBatch, see there
+#define MAX_EXTENSIONS 4
+#define LMR_MIN_DEPTH 3
+#define LMR_MIN_MOVES 3
+#define LMR_LATE_MOVES 8
+#define LMR_REDUCTION 1
+#define MAX_DEPTH 60
+#define SCORE_DROP 30
+#define PONDER_DEPTH 12
+#define PONDER_REPLIES 2
+#define MCTS_POOL_NODES (1 << 21)
+#define MCTS_PLAYOUTS 20000 // root visits per move when there is no clock
+#define MCTS_EXPLORATION 1.5f
+#define MCTS_VIRTUAL_LOSS 3
+#define MCTS_EXPAND_VISITS 2
+#define MCTS_PRIOR_TEMPERATURE 50.0f
+#define MCTS_REPORT_PLAYOUTS 4096
+#define EMERGENCY_TIME 10 // ms of hard budget below which only the emergency search runs
+#define EMERGENCY_LATENCY 1.0 // ms since the move started after which no deeper emergency ply is searched
+#define EMERGENCY_DEPTH 2
+#define EMERGENCY_MOBILITY 4 // weight of the mobility restriction over the evaluation
+#define EMERGENCY_CORNER 8 // a corner is worth this many moves of mobility
+
+enum TABLE_SCORE
+{
+    C = 10,
+    X = -10,
+    N = -5,
+    M = 0
+};
+
+// score_table with the given value for the edge squares between the C-squares
+inline ScoreTable make_score_table(int E)
+{
+    return ScoreTable{{C, N, E, E, E, E, N, C,
+                       N, X, M, M, M, M, X, N,
+                       E, M, M, M, M, M, M, E,
+                       E, M, M, M, M, M, M, E,
+                       E, M, M, M, M, M, M, E,
+                       E, M, M, M, M, M, M, E,
+                       N, X, M, M, M, M, X, N,
+                       C, N, E, E, E, E, N, C}};
+}
+
+// heuristic score; a term with weight 0 is skipped
+struct Weights
+{
+    ScoreTable score_table = make_score_table(1);
+    int corner = 100;
+    int xspot = -100;
+    int cspot = -50;
+    int mobility = 10;
+    int potential_mobility = 0;
+    int frontier = 0;
+    int disc = 1;
+    int stability = 10;
+    int parity = 20;
+};
+
+// Evaluation terms per game phase, in percent of the player's Weights. A phase
+// with 0 for a term has that term compiled out of its evaluator.
+struct PhaseProfile
+{
+    int min_empties; // the phase runs from here up to the previous phase
+    int corner;      // corners and the X- and C-squares next to empty ones
+    int mobility;
+    int potential_mobility;
+    int frontier;
+    int stability;
+    int parity;
+    int disc;
+};
+const int PHASES = 3;
+constexpr PhaseProfile PHASE_PROFILES[PHASES] = {
+    // opening: no stable discs or parity to speak of, few discs says little
+    {45, 100, 100, 100, 100, 0, 0, 0},
+    // midgame
+    {21, 100, 100, 100, 100, 100, 0, 0},
+    // endgame: stable discs and the disc count itself decide
+    {0, 100, 100, 0, 0, 150, 100, 100},
+};
+
+constexpr std::array<int, SIZE * SIZE + 1> make_phase_table()
+{
+    std::array<int, SIZE * SIZE + 1> table{};
+    for (int empties = 0; empties <= SIZE * SIZE; empties++)
+    {
+        int phase = 0;
+        while (empties < PHASE_PROFILES[phase].min_empties)
+            phase++;
+        table[empties] = phase;
+    }
+    return table;
+}
+// phase of a position by its empty squares
+constexpr std::array<int, SIZE * SIZE + 1> PHASE_OF_EMPTIES = make_phase_table();
+
+constexpr int phase_weight(int weight, int percent)
+{
+    return weight * percent / 100;
+}
+
+const std::array<Square, 4> corners{{to_square(0, 0), to_square(0, SIZE - 1), to_square(SIZE - 1, 0), to_square(SIZE - 1, SIZE - 1)}};
+const std::array<Square, 4> xspots{{to_square(1, 1), to_square(1, SIZE - 2), to_square(SIZE - 2, 1), to_square(SIZE - 2, SIZE - 2)}};
+const std::array<std::array<Square, 2>, 4> cspots{{{{to_square(0, 1), to_square(1, 0)}},
+                                                   {{to_square(0, SIZE - 2), to_square(1, SIZE - 1)}},
+                                                   {{to_square(SIZE - 2, 0), to_square(SIZE - 1, 1)}},
+                                                   {{to_square(SIZE - 2, SIZE - 1), to_square(SIZE - 1, SIZE - 2)}}}};
+// the same squares as bitboards
+const Bitboard XSPOT_MASK = 0x0042000000004200ULL;
+const Bitboard CSPOT_MASK = 0x4281000000008142ULL;
+
+// search counters, printed per iteration with show_stats
+struct SearchStats
+{
+    uint64_t extensions;        // corner moves, single replies and passes searched without losing a ply
+    uint64_t extensions_denied; // the same, once the path's MAX_EXTENSIONS budget was spent
+    uint64_t reductions;        // late moves searched at reduced depth
+    uint64_t re_searches;       // reduced moves searched again at full depth
+};
+
+// The children of a depth-1 node, made up front so the hand-written terms can
+// run over several at once: one loop per term over structure-of-arrays
+// bitboards. Slots follow the node's move order.
+//
+// LEAF_BATCH is 1 because beta cutoffs decide the size, not the term loops.
+// Over the 60 test positions at depth 7, a whole node per batch evaluated 4.47M
+// leaves in 749 ms, 2 children 1.84M in 411 ms and 1 child 1.58M in 336 ms:
+// every child made past a cutoff is wasted. The batch stays so the size can be
+// retuned when the terms get cheaper per position than a wasted leaf costs.
+struct LeafBatch
+{
+    int value[MAX_MOVES];  // leaf values, from player's side
+    int queued;            // children waiting for evaluate_leaves
+    int empties;           // of every child
+    int slot[MAX_MOVES];   // per queued child: its move slot
+    uint64_t hash[MAX_MOVES];
+    Bitboard own[MAX_MOVES], opp[MAX_MOVES]; // player's and opponent's discs
+    int parity[MAX_MOVES]; // see parity_count
+};
+
+// A position we may be asked about next, searched while the opponent thinks.
+struct PonderLine
+{
+    uint64_t hash;
+    int depth; // last completed iteration, 0 if none
+    Square move;
+};
+
+// Parallel exact endgame solver (win/loss/draw). Nodes with SPLIT_EMPTIES or
+// more empties search their first move alone and then publish the remaining
+// ones as a split point (Young Brothers Wait); idle threads steal moves from
+// the oldest open split point. A cutoff at a split point cancels every search
+// still running below it. Threads without work sleep on split_changed; an
+// owner whose moves are all handed out helps below its own split point until
+// its helpers are done (helpful master).
+struct SplitPoint
+{
+    State state;
+    bool maximize_player;
+    MoveList moves;           // in search order
+    std::atomic<int> next;    // index of the next move to hand out
+    std::atomic<int> helpers; // threads other than the owner working on it
+    std::atomic<bool> cutoff;
+    std::mutex lock; // guards the fields below
+    int alpha, beta, value;
+    Square best;
+    SplitPoint *parent;
+
+    SplitPoint(const State &curState, bool maximize, const MoveList &ordered, int first, int a, int b, int v, Square sq, SplitPoint *up)
+        : state(curState), maximize_player(maximize), moves(ordered), next(first), helpers(0), cutoff(false),
+          alpha(a), beta(b), value(v), best(sq), parent(up)
+    {
+    }
+};
+
+// One search engine: the side it plays for, its tables, limits and counters.
+// Nothing is shared between engines, so several can search in one process; a
+// single engine is driven from one thread at a time (plus its own ponder and
+// solver threads).
+class Engine
+{
+public:
+    // settings, read at the start of every search
+    int threads;
+    bool show_stats;
+    bool batch_leaves; // evaluate depth-1 children as one LeafBatch
+    bool use_mcts;     // Monte Carlo tree search instead of alpha-beta before the solver takes over
+    // shares cores with other games' engines when set; such an engine must
+    // search on one thread
+    CoreScheduler *scheduler;
+    // game clock in milliseconds, 0 when not given; the engine keeps
+    // remaining_time up to date across choose_move calls
+    double remaining_time, increment, move_time;
+
+    // counters of the last search
+    uint64_t nodes;
+    int depth_reached; // last completed iteration or emergency ply, 0 without one (book, forced move, MCTS)
+    SearchStats stats;
+
+private:
+    Weights weights;
+    int player, opponent; // values are scored for player
+    TranspositionTable tt;
+    EvalCache eval_cache;
+    SolveTable solve_table;
+    Network network;
+    bool use_network;
+    TimeManager time_manager;
+    std::atomic<bool> stop_search;
+    std::unordered_map<uint64_t, uint8_t> book;
+    std::vector<PonderLine> ponder_lines;
+    std::thread ponder_thread;
+    bool pondered; // pondering began the table generation of the next move
+    // parallel solver
+    std::mutex split_lock; // guards split_points and the split points' helpers
+    std::condition_variable split_changed; // a split point opened, a helper left or the solve ended
+    std::vector<SplitPoint *> split_points;
+    std::atomic<int> idle_threads;
+    std::atomic<bool> solver_done;
+    // Monte Carlo tree search, the pool allocated on first use
+    std::unique_ptr<MctsPool> mcts_pool;
+    uint32_t mcts_root;                    // node of the last search's root
+    std::unique_ptr<State> mcts_root_state; // its position
+    std::atomic<uint64_t> mcts_playouts;
+
+public:
+    explicit Engine(const Weights &w)
+        : threads(std::max(1u, std::thread::hardware_concurrency())), show_stats(false), batch_leaves(true), use_mcts(false), scheduler(nullptr),
+          remaining_time(0), increment(0), move_time(0), nodes(0), depth_reached(0), stats(), weights(w),
+          player(BLACK), opponent(WHITE), tt(TT_BITS), eval_cache(EVAL_CACHE_BITS), solve_table(SOLVE_TABLE_BITS),
+          use_network(false), stop_search(false), pondered(false), idle_threads(0), solver_done(false), mcts_root(0), mcts_playouts(0)
+    {
+    }
+    ~Engine()
+    {
+        stop_pondering();
+    }
+    Engine(const Engine &) = delete;
+    Engine &operator=(const Engine &) = delete;
+
+    // the side whose values the engine computes
+    // Table values are scored for player, so a change of side forgets them;
+    // call it between searches only.
+    void set_player(int side)
+    {
+        if (side != player)
+            tt.clear();
+        player = side;
+        opponent = 3 - side;
+    }
+    int get_player() const
+    {
+        return player;
+    }
+    // A position with this engine's move ordering, network and transposition
+    // table (for prefetching) attached.
+    State make_state(const Grid &board, int side_to_move) const
+    {
+        return State(board, side_to_move, weights.score_table, use_network ? &network : nullptr, &tt);
+    }
+    State make_state(const Grid &board, int side_to_move, const std::vector<Square> &valid_spots) const
+    {
+        return State(board, side_to_move, valid_spots, weights.score_table, use_network ? &network : nullptr, &tt);
+    }
+    bool load_network(const char *path)
+    {
+        use_network = network.load(path);
+        return use_network;
+    }
+    // evaluate with arbitrary weights, for timing without a trained file
+    void use_random_network(uint64_t seed)
+    {
+        network.randomize(seed);
+        use_network = true;
+    }
+    bool has_network() const
+    {
+        return use_network;
+    }
+    void set_network_enabled(bool enabled)
+    {
+        use_network = enabled;
+    }
+    void resize_eval_cache(int bits)
+    {
+        eval_cache.resize(bits);
+    }
+    // forgets every solved position, so timings start from an empty table
+    void clear_solve_table()
+    {
+        solve_table.clear();
+    }
+    // stops a running search from another thread
+    void stop()
+    {
+        stop_search = true;
+    }
+
+    void load_book(const char *path);
+    bool book_move(const State &curState, Square &move) const;
+
+    template <int PHASE>
+    void evaluate_phase(const Bitboard *own, const Bitboard *opp, const int *parity, int n, int *h) const;
+    void evaluate_positions(int empties, const Bitboard *own, const Bitboard *opp, const int *parity, int n, int *h) const;
+    int parity_count(const State &curState) const;
+    int evaluate_terms(const State &curState) const;
+    int static_value(const State &curState) const;
+    int heuristic(const State &curState);
+    int gameEnd(const State &curState) const;
+    int game_outcome(const State &curState) const;
+    int restriction_value(const State &curState) const;
+    int minmax_function(const State &curState, int depth, bool maximize_player);
+    // Move for a nearly spent clock: a mobility restriction search one ply
+    // deep, then two unless EMERGENCY_LATENCY has passed since the move began.
+    Square emergency_move(const State &root, std::ostream *progress);
+
+    bool search_root(const State &initState, int depth, Square &best_move, int &best_value);
+    Square iterative_deepening(const State &initState, int start_depth, int max_depth, Square best, std::ostream *progress);
+    bool solve_root(const State &initState, Square &best_move, int &best_value);
+    // Tree-parallel MCTS on engine.threads threads until the clock's soft
+    // limit, or MCTS_PLAYOUTS root visits without a clock. The subtree of the
+    // position reached from the last search's root is kept. Improvements of the
+    // most visited move are written to progress when given.
+    Square mcts_search(const State &root, std::ostream *progress);
+    // Picks a move for root within the clock: a book move, the forced move or a
+    // search continuing from what pondering found. Every completed iteration
+    // is written to progress when given.
+    Square choose_move(const State &root, std::ostream *progress);
+
+    // Searches the expected replies to our move on a background thread until
+    // stop_pondering; choose_move picks up the result.
+    void start_pondering(const State &root, Square move);
+    void stop_pondering();
+
+private:
+    bool stability_cutoff(const State &curState, int alpha, int beta, int &value) const;
+    bool endgame_order(const State &curState, int depth, int extensions, int alpha, int beta, bool maximize_player, MoveList &moves, int &value);
+    int extended_depth(int depth, int &extensions);
+    void evaluate_leaves(LeafBatch &batch);
+    int search_leaves(const State &curState, int alpha, int beta, bool maximize_player, bool pv_node, int extensions, MoveList &moves, Square &best_move);
+    int value_function(const State &curState, int depth, int alpha, int beta, bool maximize_player, bool passed = false, bool pv_node = false, int extensions = MAX_EXTENSIONS);
+    void ponder(State afterMove);
+
+    bool cancelled(const SplitPoint *sp) const;
+    int outcome_for_black(int value) const;
+    int value_from_black(int outcome) const;
+    int flag_for_black(int flag) const;
+    int solve(const State &curState, int alpha, int beta, bool maximize_player, SplitPoint *parent, uint64_t &count, Square *best_move = nullptr, bool passed = false);
+    void search_split(SplitPoint &sp, uint64_t &count);
+    SplitPoint *open_split_point(const SplitPoint *below) const;
+    void help_split(std::unique_lock<std::mutex> &held, SplitPoint *sp, uint64_t &count);
+    void solver_worker(uint64_t &count);
+
+    bool checkpoint();
+    bool mcts_finished() const;
+    bool mcts_expand(MctsNode &node, const State &curState);
+    uint32_t mcts_select(MctsNode &node);
+    uint32_t mcts_find_root(const State &root);
+    Square mcts_best_move();
+    void mcts_worker(const State &root, int thread, std::ostream *progress);
+};
+
+inline int disc_count_heuristic(const State &curState, int player)
+{
+    return curState.disc_count[player] - curState.disc_count[3 - player];
+}
+
+// The hand-written terms of one phase for n positions given as player's and
+// opponent's discs plus the signed parity count, one loop per term so a whole
+// LeafBatch is evaluated term by term. Terms the phase leaves out are not
+// compiled into its evaluator at all.
+template <int PHASE>
+inline void Engine::evaluate_phase(const Bitboard *own, const Bitboard *opp, const int *parity, int n, int *h) const
+{
+    constexpr PhaseProfile profile = PHASE_PROFILES[PHASE];
+    Bitboard empty[MAX_MOVES];
+    for (int i = 0; i < n; i++)
+        empty[i] = ~(own[i] | opp[i]);
+    // corners, and the X- and C-squares next to the empty ones
+    for (int i = 0; i < n; i++)
+    {
+        Bitboard open = 0;
+        for (int c = 0; c < 4; c++)
+            open |= (0 - ((empty[i] >> corners[c]) & 1)) & Square_Tables.neighbors[corners[c]];
+        h[i] = (bit_count(own[i] & CORNERS) - bit_count(opp[i] & CORNERS)) * phase_weight(weights.corner, profile.corner) +
+               (bit_count(own[i] & open & XSPOT_MASK) - bit_count(opp[i] & open & XSPOT_MASK)) * phase_weight(weights.xspot, profile.corner) +
+               (bit_count(own[i] & open & CSPOT_MASK) - bit_count(opp[i] & open & CSPOT_MASK)) * phase_weight(weights.cspot, profile.corner);
+    }
+    if constexpr (profile.mobility)
+    {
+        if (weights.mobility)
+        {
+            const MoveGenerator &generator = move_generator();
+            for (int i = 0; i < n; i++)
+                h[i] += (bit_count(generator.legal(own[i], opp[i])) - bit_count(generator.legal(opp[i], own[i]))) * phase_weight(weights.mobility, profile.mobility);
+        }
+    }
+    if constexpr (profile.potential_mobility)
+    {
+        if (weights.potential_mobility)
+        {
+            for (int i = 0; i < n; i++)
+                h[i] += (bit_count(empty[i] & neighbor_squares(opp[i])) - bit_count(empty[i] & neighbor_squares(own[i]))) * phase_weight(weights.potential_mobility, profile.potential_mobility);
+        }
+    }
+    if constexpr (profile.frontier)
+    {
+        if (weights.frontier)
+        {
+            for (int i = 0; i < n; i++)
+            {
+                Bitboard frontier = neighbor_squares(empty[i]);
+                h[i] += (bit_count(own[i] & frontier) - bit_count(opp[i] & frontier)) * phase_weight(weights.frontier, profile.frontier);
+            }
+        }
+    }
+    if constexpr (profile.stability)
+    {
+        if (weights.stability)
+        {
+            for (int i = 0; i < n; i++)
+                h[i] += (bit_count(stable_discs(own[i], opp[i])) - bit_count(stable_discs(opp[i], own[i]))) * phase_weight(weights.stability, profile.stability);
+        }
+    }
+    if constexpr (profile.parity)
+    {
+        if (weights.parity)
+        {
+            for (int i = 0; i < n; i++)
+                h[i] += parity[i] * phase_weight(weights.parity, profile.parity);
+        }
+    }
+    if constexpr (profile.disc)
+    {
+        if (weights.disc)
+        {
+            for (int i = 0; i < n; i++)
+                h[i] += (bit_count(own[i]) - bit_count(opp[i])) * phase_weight(weights.disc, profile.disc);
+        }
+    }
+}
+
+// Jump table of the phase evaluators, indexed through PHASE_OF_EMPTIES.
+inline void Engine::evaluate_positions(int empties, const Bitboard *own, const Bitboard *opp, const int *parity, int n, int *h) const
+{
+    typedef void (Engine::*PhaseEvaluator)(const Bitboard *, const Bitboard *, const int *, int, int *) const;
+    static constexpr PhaseEvaluator evaluators[PHASES] = {&Engine::evaluate_phase<0>, &Engine::evaluate_phase<1>, &Engine::evaluate_phase<2>};
+    (this->*evaluators[PHASE_OF_EMPTIES[empties]])(own, opp, parity, n, h);
+}
+
+// odd quadrants, signed for the side to move; 0 above PARITY_EMPTIES
+inline int Engine::parity_count(const State &curState) const
+{
+    int odd = curState.disc_count[EMPTY] <= PARITY_EMPTIES ? bit_count(curState.parity) : 0;
+    return curState.cur_player == player ? odd : -odd;
+}
+
+// the hand-written evaluation terms
+inline int Engine::evaluate_terms(const State &curState) const
+{
+    Bitboard own = curState.get_bitboard(player), opp = curState.get_bitboard(opponent);
+    int parity = parity_count(curState), h;
+    evaluate_positions(curState.disc_count[EMPTY], &own, &opp, &parity, 1, &h);
+    return h;
+}
+
+// the network or the hand-written terms, without the cache, so any thread
+// may call it
+inline int Engine::static_value(const State &curState) const
+{
+    if (curState.network)
+    {
+        int v = curState.network->evaluate(curState.accumulator);
+        return clamp_heuristic(player == BLACK ? v : -v);
+    }
+    return clamp_heuristic(evaluate_terms(curState));
+}
+
+inline int Engine::heuristic(const State &curState)
+{
+    if (curState.network)
+        return static_value(curState);
+    int h;
+    if (eval_cache.probe(curState.hash, player, h))
+        return h;
+    h = static_value(curState);
+    eval_cache.store(curState.hash, player, h);
+    return h;
+}
+
+// evaluate_terms over every queued child of the batch at once
+inline void Engine::evaluate_leaves(LeafBatch &batch)
+{
+    int h[MAX_MOVES];
+    evaluate_positions(batch.empties, batch.own, batch.opp, batch.parity, batch.queued, h);
+    for (int i = 0; i < batch.queued; i++)
+    {
+        int value = clamp_heuristic(h[i]);
+        batch.value[batch.slot[i]] = value;
+        eval_cache.store(batch.hash[i], player, value);
+    }
+}
+
+inline int Engine::gameEnd(const State &curState) const
+{
+    return final_score(curState.disc_count[player] - curState.disc_count[opponent]);
+}
+
+// gameEnd without the margin, for the win/loss/draw solver
+inline int Engine::game_outcome(const State &curState) const
+{
+    return outcome_score(curState.disc_count[player] - curState.disc_count[opponent]);
+}
+
+// moves are stored in the orientation of the key
+inline uint8_t to_stored_move(uint8_t move, int sym)
+{
+    return move == NO_MOVE ? NO_MOVE : symmetry_square(move, sym);
+}
+
+inline uint8_t from_stored_move(uint8_t move, int sym)
+{
+    return move == NO_MOVE ? NO_MOVE : inverse_symmetry_square(move, sym);
+}
+
+// Loads an opening book with one line per opening, written as a move sequence
+// such as "f5d6c3" (column letter is y, row digit is x). Every position along a
+// line is stored once for all of its orientations with the move played there.
+inline void Engine::load_book(const char *path)
+{
+    std::ifstream fin(path);
+    Grid start{};
+    start[3][3] = start[4][4] = WHITE;
+    start[3][4] = start[4][3] = BLACK;
+    std::string line;
+    while (std::getline(fin, line))
+    {
+        if (line.empty() || line[0] == '#')
+            continue;
+        State curState(start, BLACK, weights.score_table);
+        for (size_t i = 0; i + 1 < line.size(); i += 2)
+        {
+            if (curState.next_valid_spots.empty())
+                curState.pass();
+            Square sq = to_square(line[i + 1] - '1', std::tolower(line[i]) - 'a');
+            if (!curState.next_valid_spots.contains(sq))
+                break;
+            int sym;
+            uint64_t key = position_key(curState, true, sym);
+            book.emplace(key, to_stored_move(sq, sym));
+            curState.put_disc(sq);
+        }
+    }
+}
+
+inline bool Engine::book_move(const State &curState, Square &move) const
+{
+    int sym;
+    auto it = book.find(position_key(curState, true, sym));
+    if (it == book.end())
+        return false;
+    Square sq = from_stored_move(it->second, sym);
+    if (!curState.next_valid_spots.contains(sq))
+        return false;
+    move = sq;
+    return true;
+}
+
+// Stable discs are final: with s of them a side ends at least 2s - 64 discs
+// ahead, so more than half of the board stable decides the game and exactly
+// half bounds it by a draw. Returns true with that bound when it alone makes
+// the node fail low or high.
+inline bool Engine::stability_cutoff(const State &curState, int alpha, int beta, int &value) const
+{
+    const int HALF = SIZE * SIZE / 2;
+    if (curState.disc_count[player] < HALF && curState.disc_count[opponent] < HALF)
+        return false;
+    Bitboard own = curState.get_bitboard(player), opp = curState.get_bitboard(opponent);
+    if (curState.disc_count[player] >= HALF)
+    {
+        int stable = bit_count(stable_discs(own, opp));
+        if (stable >= HALF && fails_high(final_score(2 * stable - SIZE * SIZE), beta))
+        {
+            value = final_score(2 * stable - SIZE * SIZE);
+            return true;
+        }
+    }
+    else
+    {
+        int stable = bit_count(stable_discs(opp, own));
+        if (stable >= HALF && fails_low(final_score(SIZE * SIZE - 2 * stable), alpha))
+        {
+            value = final_score(SIZE * SIZE - 2 * stable);
+            return true;
+        }
+    }
+    return false;
+}
+
+inline bool is_corner(Square sq)
+{
+    return (CORNERS >> sq) & 1;
+}
+
+// Deep endgame ordering: fewest opponent replies first (fastest-first), ties
+// broken by moves into odd quadrants, then by score_table.
+inline int fastest_first_score(const State &curState, const State &newState, Square sq)
+{
+    int score = (MAX_MOVES - newState.next_valid_spots.size()) * 64 + (*curState.scores)[sq];
+    if (curState.parity >> quadrant(sq) & 1)
+        score += PARITY_ORDER;
+    return score;
+}
+
+// Orders by fastest_first_score. Every child is probed in the transposition
+// table before any is searched (enhanced transposition cutoff); returns true
+// with the cutoff value when one of them already refutes the node.
+inline bool Engine::endgame_order(const State &curState, int depth, int extensions, int alpha, int beta, bool maximize_player, MoveList &moves, int &value)
+{
+    MoveList ordered;
+    for (int i = 0; i < curState.next_valid_spots.size(); i++)
+    {
+        Square sq = curState.next_valid_spots[i];
+        State newState = curState;
+        newState.put_disc(sq);
+        int sym;
+        const TTEntry *entry = tt.probe(position_key(newState, SYMMETRY_HASH, sym));
+        if (entry && entry->depth >= (is_corner(sq) && extensions > 0 ? depth : depth - 1))
+        {
+            if (maximize_player && entry->flag != TT_UPPER && entry->value >= beta)
+            {
+                value = entry->value;
+                return true;
+            }
+            if (!maximize_player && entry->flag != TT_LOWER && entry->value <= alpha)
+            {
+                value = entry->value;
+                return true;
+            }
+        }
+        ordered.push(sq, fastest_first_score(curState, newState, sq));
+    }
+    moves = ordered;
+    return false;
+}
+
+// Late move reduction for the i-th move of a node: moves after the first
+// LMR_MIN_MOVES lose LMR_REDUCTION plies, after LMR_LATE_MOVES one more.
+inline int lmr_reduction(int depth, int i, bool pv_node)
+{
+    if (pv_node || depth < LMR_MIN_DEPTH || i < LMR_MIN_MOVES)
+        return 0;
+    return std::min(depth - 1, i < LMR_LATE_MOVES ? LMR_REDUCTION : LMR_REDUCTION + 1);
+}
+
+// Depth for a child the search would rather not count as a ply (corner move,
+// single reply or pass): unchanged while the path has extension budget left.
+inline int Engine::extended_depth(int depth, int &extensions)
+{
+    if (extensions > 0)
+    {
+        extensions--;
+        stats.extensions++;
+        return depth;
+    }
+    stats.extensions_denied++;
+    return depth - 1;
+}
+
+// Depth-1 node with several moves: the children are made and evaluated
+// LEAF_BATCH at a time as one LeafBatch, then scanned in move order with the
+// same cutoffs as value_function, so a cutoff wastes at most the rest of its
+// batch. A corner child that keeps its ply is searched as usual.
+inline int Engine::search_leaves(const State &curState, int alpha, int beta, bool maximize_player, bool pv_node, int extensions, MoveList &moves, Square &best_move)
+{
+    LeafBatch batch;
+    int value = maximize_player ? -SCORE_INF : SCORE_INF;
+    for (int first = 0; first < moves.size(); first += LEAF_BATCH)
+    {
+        int last = std::min(moves.size(), first + LEAF_BATCH);
+        batch.queued = 0;
+        batch.empties = curState.disc_count[EMPTY] - 1;
+        for (int i = first; i < last; i++)
+        {
+            Square sq = moves.pick(i);
+            // a corner child that keeps its ply is searched below instead
+            if (is_corner(sq) && extensions > 0)
+                continue;
+            State newState = curState;
+            newState.put_disc(sq);
+            if (newState.disc_count[EMPTY] == 0)
+                batch.value[i] = gameEnd(newState);
+            else if (newState.network)
+                batch.value[i] = heuristic(newState);
+            else if (!eval_cache.probe(newState.hash, player, batch.value[i]))
+            {
+                int q = batch.queued++;
+                batch.slot[q] = i;
+                batch.hash[q] = newState.hash;
+                batch.own[q] = newState.get_bitboard(player);
+                batch.opp[q] = newState.get_bitboard(opponent);
+                batch.parity[q] = parity_count(newState);
+            }
+        }
+        evaluate_leaves(batch);
+
+        for (int i = first; i < last; i++)
+        {
+            Square sq = moves[i];
+            int new_value;
+            int child_extensions = extensions;
+            if (is_corner(sq) && extended_depth(1, child_extensions) == 1)
+            {
+                State newState = curState;
+                newState.put_disc(sq);
+                new_value = value_function(newState, 1, alpha, beta, !maximize_player, false, pv_node && i == 0, child_extensions);
+            }
+            else
+            {
+                // what value_function does on reaching the leaf
+                if ((++nodes & 1023) == 0 && checkpoint())
+                    stop_search = true;
+                new_value = stop_search ? 0 : batch.value[i];
+            }
+            if ((maximize_player ? new_value > value : new_value < value) || best_move == NO_MOVE)
+            {
+                value = new_value;
+                best_move = sq;
+            }
+            if (maximize_player)
+                alpha = std::max(alpha, value);
+            else
+                beta = std::min(beta, value);
+            if (alpha >= beta)
+                return value;
+        }
+    }
+    return value;
+}
+
+// Every 1024 nodes: lets the scheduler move this search off its core, then
+// tells whether the hard time limit has passed.
+inline bool Engine::checkpoint()
+{
+    if (scheduler)
+        scheduler->checkpoint(this);
+    return time_manager.hard_expired();
+}
+
+inline int Engine::value_function(const State &curState, int depth, int alpha, int beta, bool maximize_player, bool passed, bool pv_node, int extensions)
+{
+    if ((++nodes & 1023) == 0 && checkpoint())
+        stop_search = true;
+    if (stop_search)
+    {
+        return 0;
+    }
+    else if (curState.disc_count[EMPTY] == 0)
+    {
+        return gameEnd(curState);
+    }
+    // else if (curState.disc_count[player] == 0)
+    // {
+    //     return -SCORE_INF;
+    // }
+    // else if (curState.disc_count[opponent] == 0)
+    // {
+    //     return SCORE_INF;
+    // }
+    else if (depth == 0)
+    {
+        return heuristic(curState);
+    }
+
+    int proven;
+    if (stability_cutoff(curState, alpha, beta, proven))
+        return proven;
+
+    const int alpha_orig = alpha, beta_orig = beta;
+    int sym;
+    uint64_t key = position_key(curState, SYMMETRY_HASH, sym);
+    const TTEntry *entry = tt.probe(key);
+    Square hash_move = entry ? from_stored_move(entry->move, sym) : NO_MOVE;
+    if (entry && entry->depth >= depth)
+    {
+        if (entry->flag == TT_EXACT)
+            return entry->value;
+        if (entry->flag == TT_LOWER)
+            alpha = std::max(alpha, (int)entry->value);
+        else
+            beta = std::min(beta, (int)entry->value);
+        if (alpha >= beta)
+            return entry->value;
+    }
+
+    MoveList moves = curState.next_valid_spots;
+    if (moves.size() > 1 && depth > 1 && curState.disc_count[EMPTY] <= ENDGAME_EMPTIES)
+    {
+        int etc_value;
+        if (endgame_order(curState, depth, extensions, alpha, beta, maximize_player, moves, etc_value))
+            return etc_value;
+    }
+    // the best move of an earlier search of this position goes first
+    if (hash_move != NO_MOVE)
+        moves.promote(hash_move);
+
+    int value;
+    Square best_move = NO_MOVE;
+    if (batch_leaves && depth == 1 && moves.size() > 1)
+    {
+        value = search_leaves(curState, alpha, beta, maximize_player, pv_node, extensions, moves, best_move);
+    }
+    else if (maximize_player)
+    {
+        value = -SCORE_INF;
+        if (curState.next_valid_spots.size() == 0)
+        {
+            if (passed)
+                return gameEnd(curState);
+
+            State newState = curState;
+            newState.pass();
+            int child_depth = extended_depth(depth, extensions);
+            value = std::max(value, value_function(newState, child_depth, alpha, beta, false, true, pv_node, extensions));
+        }
+        else if (curState.next_valid_spots.size() == 1)
+        {
+            State newState = curState;
+            newState.put_disc(curState.next_valid_spots[0]);
+            int child_depth = extended_depth(depth, extensions);
+            value = std::max(value, value_function(newState, child_depth, alpha, beta, false, false, pv_node, extensions));
+            best_move = curState.next_valid_spots[0];
+        }
+        else
+        {
+            for (int i = 0; i < moves.size(); i++)
+            {
+                Square sq = moves.pick(i);
+                State newState = curState;
+                newState.put_disc(sq);
+                bool child_pv = pv_node && i == 0;
+                int new_value;
+                // corner move
+                if (is_corner(sq))
+                {
+                    int child_extensions = extensions;
+                    int child_depth = extended_depth(depth, child_extensions);
+                    new_value = value_function(newState, child_depth, alpha, beta, false, false, child_pv, child_extensions);
+                }
+                else
+                {
+                    int reduction = lmr_reduction(depth, i, pv_node);
+                    if (reduction > 0)
+                        stats.reductions++;
+                    new_value = value_function(newState, depth - 1 - reduction, alpha, beta, false, false, child_pv, extensions);
+                    // a reduced move that looks better than expected gets a full-depth search
+                    if (reduction > 0 && new_value > alpha)
+                    {
+                        stats.re_searches++;
+                        new_value = value_function(newState, depth - 1, alpha, beta, false, false, false, extensions);
+                    }
+                }
+                if (new_value > value || best_move == NO_MOVE)
+                {
+                    value = new_value;
+                    best_move = sq;
+                }
+                alpha = std::max(alpha, value);
+                if (alpha >= beta)
+                    break;
+            }
+        }
+    }
+    else
+    {
+        value = SCORE_INF;
+        if (curState.next_valid_spots.size() == 0)
+        {
+            if (passed)
+                return gameEnd(curState);
+
+            State newState = curState;
+            newState.pass();
+            int child_depth = extended_depth(depth, extensions);
+            value = std::min(value, value_function(newState, child_depth, alpha, beta, true, false, pv_node, extensions));
+        }
+        else if (curState.next_valid_spots.size() == 1)
+        {
+            State newState = curState;
+            newState.put_disc(curState.next_valid_spots[0]);
+            int child_depth = extended_depth(depth, extensions);
+            value = std::min(value, value_function(newState, child_depth, alpha, beta, true, false, pv_node, extensions));
+            best_move = curState.next_valid_spots[0];
+        }
+        else
+        {
+            for (int i = 0; i < moves.size(); i++)
+            {
+                Square sq = moves.pick(i);
+                State newState = curState;
+                newState.put_disc(sq);
+                bool child_pv = pv_node && i == 0;
+                int new_value;
+                // corner move
+                if (is_corner(sq))
+                {
+                    int child_extensions = extensions;
+                    int child_depth = extended_depth(depth, child_extensions);
+                    new_value = value_function(newState, child_depth, alpha, beta, true, false, child_pv, child_extensions);
+                }
+                else
+                {
+                    int reduction = lmr_reduction(depth, i, pv_node);
+                    if (reduction > 0)
+                        stats.reductions++;
+                    new_value = value_function(newState, depth - 1 - reduction, alpha, beta, true, false, child_pv, extensions);
+                    // a reduced move that looks better than expected gets a full-depth search
+                    if (reduction > 0 && new_value < beta)
+                    {
+                        stats.re_searches++;
+                        new_value = value_function(newState, depth - 1, alpha, beta, true, false, false, extensions);
+                    }
+                }
+                if (new_value < value || best_move == NO_MOVE)
+                {
+                    value = new_value;
+                    best_move = sq;
+                }
+                beta = std::min(beta, value);
+                if (beta <= alpha)
+                    break;
+            }
+        }
+    }
+
+    int flag = bound_flag(value, alpha_orig, beta_orig);
+    if (!stop_search)
+        tt.store(key, depth, value, flag, to_stored_move(best_move, sym));
+    return value;
+}
+
+// Leaf of the emergency search: the evaluation plus our mobility against the
+// opponent's, with the corners on top since none of the moves it buys is worth
+// giving one away. Two plies are too shallow for the evaluation's own mobility
+// term to keep the opponent short of moves.
+inline int Engine::restriction_value(const State &curState) const
+{
+    const MoveGenerator &generator = move_generator();
+    Bitboard own = curState.discs[player], opp = curState.discs[opponent];
+    int mobility = bit_count(generator.legal(own, opp)) - bit_count(generator.legal(opp, own));
+    int restriction = mobility + EMERGENCY_CORNER * (bit_count(own & CORNERS) - bit_count(opp & CORNERS));
+    return clamp_heuristic(static_value(curState) + EMERGENCY_MOBILITY * restriction);
+}
+
+// Plain minimax on restriction_value, without tables, windows or the
+// evaluation cache, so a couple of plies cost well under a millisecond.
+inline int Engine::minmax_function(const State &curState, int depth, bool maximize_player)
+{
+    nodes++;
+    if (curState.disc_count[EMPTY] == 0)
+    {
+        return gameEnd(curState);
+    }
+    else if (depth == 0)
+    {
+        return restriction_value(curState);
+    }
+    if (curState.next_valid_spots.size() == 0)
+    {
+        State newState = curState;
+        newState.pass();
+        if (newState.next_valid_spots.size() == 0)
+            return gameEnd(curState);
+        return minmax_function(newState, depth, !maximize_player);
+    }
+    int value = maximize_player ? -SCORE_INF : SCORE_INF;
+    for (int i = 0; i < curState.next_valid_spots.size(); i++)
+    {
+        Square sq = curState.next_valid_spots[i];
+        State newState = curState;
+        newState.put_disc(sq);
+        int new_value = minmax_function(newState, depth - 1, !maximize_player);
+        value = maximize_player ? std::max(value, new_value) : std::min(value, new_value);
+    }
+    return value;
+}
+
+inline Square Engine::emergency_move(const State &root, std::ostream *progress)
+{
+    MoveList moves = root.next_valid_spots;
+    Square best = moves.best();
+    for (int depth = 1; depth <= EMERGENCY_DEPTH; depth++)
+    {
+        int value = -SCORE_INF;
+        Square depth_best = best;
+        bool finished = true;
+        for (int i = 0; i < moves.size(); i++)
+        {
+            // the first ply always completes, deeper ones only within the bound
+            if (depth > 1 && time_manager.elapsed() >= EMERGENCY_LATENCY)
+            {
+                finished = false;
+                break;
+            }
+            // in score_table order, so ties keep the better static move
+            Square sq = moves.pick(i);
+            State newState = root;
+            newState.put_disc(sq);
+            int new_value = minmax_function(newState, depth - 1, false);
+            if (new_value > value)
+            {
+                value = new_value;
+                depth_best = sq;
+            }
+        }
+        if (!finished)
+            break;
+        best = depth_best;
+        depth_reached = depth;
+        if (show_stats)
+            std::cerr << "emergency depth " << depth << " value " << value << " nodes " << nodes << " time " << time_manager.elapsed() << " ms" << std::endl;
+        if (progress)
+        {
+            *progress << square_x(best) << " " << square_y(best) << std::endl;
+            progress->flush();
+        }
+    }
+    return best;
+}
+
+inline bool Engine::cancelled(const SplitPoint *sp) const
+{
+    for (; sp; sp = sp->parent)
+    {
+        if (sp->cutoff)
+            return true;
+    }
+    return stop_search;
+}
+
+// Outcomes in the table are black's, so they stay valid whichever side we play.
+inline int Engine::outcome_for_black(int value) const
+{
+    if (player == WHITE)
+        value = -value;
+    return value > 0 ? 2 : value < 0 ? 0 : 1;
+}
+inline int Engine::value_from_black(int outcome) const
+{
+    int value = outcome_score(outcome - 1);
+    return player == WHITE ? -value : value;
+}
+inline int Engine::flag_for_black(int flag) const
+{
+    return player == WHITE && flag != TT_EXACT ? 3 - flag : flag;
+}
+
+inline int Engine::solve(const State &curState, int alpha, int beta, bool maximize_player, SplitPoint *parent, uint64_t &count, Square *best_move, bool passed)
+{
+    if ((++count & 1023) == 0 && checkpoint())
+        stop_search = true;
+    if (cancelled(parent))
+        return 0;
+    if (curState.disc_count[EMPTY] == 0)
+        return game_outcome(curState);
+    if (curState.next_valid_spots.empty())
+    {
+        if (passed)
+            return game_outcome(curState);
+        State newState = curState;
+        newState.pass();
+        return solve(newState, alpha, beta, !maximize_player, parent, count, nullptr, true);
+    }
+    int proven;
+    if (!best_move && stability_cutoff(curState, alpha, beta, proven))
+        return proven;
+
+    const int alpha_orig = alpha, beta_orig = beta;
+    bool use_table = curState.disc_count[EMPTY] > SOLVE_TABLE_EMPTIES;
+    uint8_t hash_move = NO_MOVE;
+    int outcome, flag;
+    if (use_table && solve_table.probe(curState.hash, outcome, flag, hash_move))
+    {
+        int stored = value_from_black(outcome);
+        flag = flag_for_black(flag);
+        if (flag == TT_LOWER)
+            alpha = std::max(alpha, stored);
+        else if (flag == TT_UPPER)
+            beta = std::min(beta, stored);
+        if ((flag == TT_EXACT || alpha >= beta) && (!best_move || hash_move != NO_MOVE))
+        {
+            if (best_move)
+                *best_move = hash_move;
+            return stored;
+        }
+    }
+
+    MoveList moves = curState.next_valid_spots;
+    if (curState.disc_count[EMPTY] > SOLVE_FASTEST_EMPTIES)
+    {
+        moves.clear();
+        for (int i = 0; i < curState.next_valid_spots.size(); i++)
+        {
+            Square sq = curState.next_valid_spots[i];
+            State newState = curState;
+            newState.put_disc(sq);
+            moves.push(sq, fastest_first_score(curState, newState, sq));
+        }
+    }
+    if (hash_move != NO_MOVE)
+        moves.promote(hash_move);
+
+    int value = maximize_player ? -SCORE_INF : SCORE_INF;
+    Square best = NO_MOVE;
+    for (int i = 0; i < moves.size() && alpha < beta; i++)
+    {
+        // Young Brothers Wait: share the rest once the first move is known
+        if (i > 0 && moves.size() - i > 1 && idle_threads > 0 && curState.disc_count[EMPTY] >= SPLIT_EMPTIES)
+        {
+            for (int j = i; j < moves.size(); j++)
+                moves.pick(j);
+            SplitPoint sp(curState, maximize_player, moves, i, alpha, beta, value, best, parent);
+            {
+                std::lock_guard<std::mutex> guard(split_lock);
+                split_points.push_back(&sp);
+            }
+            split_changed.notify_all();
+            search_split(sp, count);
+            std::unique_lock<std::mutex> held(split_lock);
+            split_points.erase(std::find(split_points.begin(), split_points.end(), &sp));
+            // help the threads still searching our moves rather than wait idle;
+            // only split points below ours, so this frame is never needed earlier
+            while (sp.helpers > 0)
+            {
+                SplitPoint *open = open_split_point(&sp);
+                if (!open)
+                {
+                    split_changed.wait(held);
+                    continue;
+                }
+                help_split(held, open, count);
+            }
+            held.unlock();
+            value = sp.value;
+            best = sp.best;
+            break;
+        }
+        Square sq = moves.pick(i);
+        State newState = curState;
+        newState.put_disc(sq);
+        int new_value = solve(newState, alpha, beta, !maximize_player, parent, count);
+        if (cancelled(parent))
+            return 0;
+        if (best == NO_MOVE || (maximize_player ? new_value > value : new_value < value))
+        {
+            value = new_value;
+            best = sq;
+        }
+        if (maximize_player)
+            alpha = std::max(alpha, value);
+        else
+            beta = std::min(beta, value);
+    }
+    if (cancelled(parent))
+        return 0;
+
+    if (use_table)
+    {
+        int flag = bound_flag(value, alpha_orig, beta_orig);
+        solve_table.store(curState.hash, outcome_for_black(value), flag_for_black(flag), best);
+    }
+    if (best_move)
+        *best_move = best;
+    return value;
+}
+
+// Searches moves of a split point until none are left or it is cut off; run by
+// its owner and by every thread that steals from it.
+inline void Engine::search_split(SplitPoint &sp, uint64_t &count)
+{
+    while (!cancelled(&sp))
+    {
+        int i = sp.next++;
+        if (i >= sp.moves.size())
+            break;
+        Square sq = sp.moves[i];
+        State newState = sp.state;
+        newState.put_disc(sq);
+        int alpha, beta;
+        {
+            std::lock_guard<std::mutex> guard(sp.lock);
+            alpha = sp.alpha;
+            beta = sp.beta;
+        }
+        int new_value = solve(newState, alpha, beta, !sp.maximize_player, &sp, count);
+        if (cancelled(&sp))
+            break;
+        std::lock_guard<std::mutex> guard(sp.lock);
+        if (sp.maximize_player ? new_value > sp.value : new_value < sp.value)
+        {
+            sp.value = new_value;
+            sp.best = sq;
+        }
+        if (sp.maximize_player)
+            sp.alpha = std::max(sp.alpha, new_value);
+        else
+            sp.beta = std::min(sp.beta, new_value);
+        if (sp.alpha >= sp.beta)
+            sp.cutoff = true;
+    }
+}
+
+// An open split point with moves left, the oldest first; with below, only one
+// under that split point. Called with split_lock held.
+inline SplitPoint *Engine::open_split_point(const SplitPoint *below) const
+{
+    for (SplitPoint *open : split_points)
+    {
+        if (open->next >= open->moves.size() || open->cutoff)
+            continue;
+        if (!below)
+            return open;
+        for (const SplitPoint *up = open->parent; up; up = up->parent)
+        {
+            if (up == below)
+                return open;
+        }
+    }
+    return nullptr;
+}
+
+// Joins sp as a helper until its moves run out; held is split_lock, locked
+// again on return. Counted as a helper before the lock is released, sp stays
+// alive: its owner waits for all helpers before it leaves.
+inline void Engine::help_split(std::unique_lock<std::mutex> &held, SplitPoint *sp, uint64_t &count)
+{
+    sp->helpers++;
+    held.unlock();
+    search_split(*sp, count);
+    held.lock();
+    sp->helpers--;
+    split_changed.notify_all();
+}
+
+inline void Engine::solver_worker(uint64_t &count)
+{
+    idle_threads++;
+    std::unique_lock<std::mutex> held(split_lock);
+    while (!solver_done)
+    {
+        SplitPoint *sp = open_split_point(nullptr);
+        if (!sp)
+        {
+            split_changed.wait(held);
+            continue;
+        }
+        idle_threads--;
+        help_split(held, sp, count);
+        idle_threads++;
+    }
+    idle_threads--;
+}
+
+// Solves the root on threads threads; false when the time ran out first. The
+// window (-1, 1) only separates wins, draws and losses, so the first winning
+// move ends the search.
+inline bool Engine::solve_root(const State &initState, Square &best_move, int &best_value)
+{
+    std::vector<uint64_t> counts(threads, 0);
+    std::vector<std::thread> workers;
+    solver_done = false;
+    for (int t = 1; t < threads; t++)
+        workers.emplace_back(&Engine::solver_worker, this, std::ref(counts[t]));
+    Square best = NO_MOVE;
+    // the solver has its own table
+    State root = initState;
+    root.table = nullptr;
+    int value = solve(root, -1, 1, true, nullptr, counts[0], &best);
+    {
+        std::lock_guard<std::mutex> guard(split_lock);
+        solver_done = true;
+    }
+    split_changed.notify_all();
+    for (std::thread &worker : workers)
+        worker.join();
+    for (uint64_t n : counts)
+        nodes += n;
+    if (stop_search || best == NO_MOVE)
+        return false;
+    best_move = best;
+    best_value = value;
+    return true;
+}
+
+inline bool Engine::search_root(const State &initState, int depth, Square &best_move, int &best_value)
+{
+    MoveList moves = initState.next_valid_spots;
+    int sym;
+    uint64_t key = position_key(initState, SYMMETRY_HASH, sym);
+    const TTEntry *entry = tt.probe(key);
+    if (entry && entry->move != NO_MOVE)
+        moves.promote(from_stored_move(entry->move, sym));
+    int value = -SCORE_INF;
+    Square best = moves.best();
+    for (int i = 0; i < moves.size(); i++)
+    {
+        Square sq = moves.pick(i);
+        State newState = initState;
+        newState.put_disc(sq);
+        int new_value = value_function(newState, depth - 1, value, SCORE_INF, false, false, i == 0);
+        if (stop_search)
+            return false;
+        if (new_value > value)
+        {
+            value = new_value;
+            best = sq;
+        }
+        // a forced win is proven: no need to look further
+        if (is_win(value))
+            break;
+    }
+    best_move = best;
+    best_value = value;
+    tt.store(key, depth, value, is_win(value) ? TT_LOWER : TT_EXACT, to_stored_move(best, sym));
+    return true;
+}
+
+// Deepens from start_depth up to max_depth or until the time manager stops it,
+// and returns the best move of the last completed iteration. Each completed
+// iteration's move is also written to progress when given. The counters it
+// adds to are reset by choose_move.
+inline Square Engine::iterative_deepening(const State &initState, int start_depth, int max_depth, Square best, std::ostream *progress)
+{
+    int value, last_value = -SCORE_INF, stable_iterations = 0;
+    for (int depth = start_depth; depth <= max_depth; depth++)
+    {
+        if (depth > start_depth && !time_manager.should_start_iteration())
+            break;
+        // close to the end, solve exactly after a few shallow iterations
+        bool solved = initState.disc_count[EMPTY] <= SOLVE_EMPTIES &&
+                      (depth > SOLVE_PROBE_DEPTH || depth >= initState.disc_count[EMPTY]);
+        if (solved)
+            depth = initState.disc_count[EMPTY];
+        Square move;
+        if (!(solved ? solve_root(initState, move, value) : search_root(initState, depth, move, value)))
+            break;
+        // every move loses alike to the win/loss/draw solver; the deepening
+        // search's move at least makes the opponent find the win
+        if (solved && is_loss(value))
+            move = best;
+        if (depth > start_depth)
+        {
+            // the best move changed late: give it time to settle
+            if (move != best)
+            {
+                time_manager.extend(1.5);
+                stable_iterations = 0;
+            }
+            // one move keeps dominating: stop sooner
+            else if (++stable_iterations >= 4)
+            {
+                time_manager.shorten(0.7);
+            }
+            if (value < last_value - SCORE_DROP)
+                time_manager.extend(1.3);
+        }
+        best = move;
+        last_value = value;
+        depth_reached = depth;
+        if (show_stats)
+        {
+            std::cerr << "depth " << depth << " value " << value << " nodes " << nodes
+                      << " extensions " << stats.extensions << " denied " << stats.extensions_denied
+                      << " reductions " << stats.reductions << " re-searches " << stats.re_searches
+                      << " eval cache hits " << (int)(eval_cache.hit_rate() * 100) << "%"
+                      << " time " << time_manager.elapsed() << " ms" << std::endl;
+        }
+        if (progress)
+        {
+            *progress << square_x(best) << " " << square_y(best) << std::endl;
+            progress->flush();
+        }
+        // game decided
+        if (solved || is_decided(value))
+            break;
+    }
+    stop_search = false;
+    return best;
+}
+
+inline Square Engine::choose_move(const State &root, std::ostream *progress)
+{
+    time_manager.start_move(remaining_time, increment, move_time, root.disc_count[EMPTY]);
+    // what pondering stored is already of this move's generation
+    if (!pondered)
+        tt.new_search();
+    pondered = false;
+    // counters of this move, whichever search below makes it
+    nodes = 0;
+    depth_reached = 0;
+    stats = SearchStats();
+    eval_cache.hits = eval_cache.misses = 0;
+    Square best = root.next_valid_spots.best();
+    int start_depth = 1;
+    for (const PonderLine &line : ponder_lines)
+    {
+        // the real move was pondered, continue from its deepest iteration
+        if (line.hash == root.hash && line.depth > 0)
+        {
+            best = line.move;
+            start_depth = line.depth + 1;
+        }
+    }
+    if (book_move(root, best))
+    {
+        start_depth = MAX_DEPTH + 1;
+        if (progress)
+        {
+            *progress << square_x(best) << " " << square_y(best) << std::endl;
+            progress->flush();
+        }
+    }
+    // forced move
+    else if (root.next_valid_spots.size() == 1)
+    {
+        start_depth = MAX_DEPTH + 1;
+    }
+    // too little time for any real search: keep what pondering found, or
+    // answer within the emergency search's latency bound
+    else if (time_manager.is_active() && time_manager.hard_limit() < EMERGENCY_TIME)
+    {
+        if (start_depth == 1)
+            best = emergency_move(root, progress);
+        start_depth = MAX_DEPTH + 1;
+    }
+    else if (use_mcts && root.disc_count[EMPTY] > SOLVE_EMPTIES)
+    {
+        best = mcts_search(root, progress);
+        start_depth = MAX_DEPTH + 1;
+    }
+    if (start_depth <= MAX_DEPTH)
+        best = iterative_deepening(root, start_depth, time_manager.is_active() ? MAX_DEPTH : DEPTH, best, progress);
+    // keep our own game clock between calls
+    if (remaining_time > 0)
+        remaining_time += increment - time_manager.elapsed();
+    time_manager.stop();
+    return best;
+}
+
+inline bool Engine::mcts_finished() const
+{
+    if (stop_search)
+        return true;
+    if (time_manager.is_active())
+        return !time_manager.should_start_iteration(1.0);
+    return (*mcts_pool)[mcts_root].visits.load(std::memory_order_relaxed) >= MCTS_PLAYOUTS;
+}
+
+// Gives a leaf its children, priors from a softmax over the static value of
+// each child for the side to move plus its score_table entry. Only the thread
+// that moved the node to MCTS_EXPANDING calls this. False when the pool is
+// spent; the node then stays a leaf for good.
+inline bool Engine::mcts_expand(MctsNode &node, const State &curState)
+{
+    int count = std::max(1, curState.next_valid_spots.size());
+    uint32_t first = mcts_pool->allocate(count);
+    if (!first)
+        return false;
+    MctsPool &pool = *mcts_pool;
+    if (curState.next_valid_spots.empty())
+    {
+        pool[first].reset(PASS_MOVE, 1);
+    }
+    else
+    {
+        float logits[MAX_MOVES], largest = -1e30f, total = 0;
+        for (int i = 0; i < count; i++)
+        {
+            Square sq = curState.next_valid_spots[i];
+            State newState = curState;
+            newState.put_disc(sq);
+            int value = static_value(newState);
+            if (curState.cur_player != player)
+                value = -value;
+            logits[i] = (value + (*curState.scores)[sq]) / MCTS_PRIOR_TEMPERATURE;
+            largest = std::max(largest, logits[i]);
+        }
+        for (int i = 0; i < count; i++)
+        {
+            logits[i] = std::exp(logits[i] - largest);
+            total += logits[i];
+        }
+        for (int i = 0; i < count; i++)
+            pool[first + i].reset(curState.next_valid_spots[i], logits[i] / total);
+    }
+    node.first_child = first;
+    node.child_count = count;
+    node.expansion.store(MCTS_EXPANDED, std::memory_order_release);
+    return true;
+}
+
+// the child with the highest PUCT value, charged a virtual loss
+inline uint32_t Engine::mcts_select(MctsNode &node)
+{
+    MctsPool &pool = *mcts_pool;
+    float sqrt_parent = std::sqrt((float)std::max(1, node.visits.load(std::memory_order_relaxed)));
+    uint32_t best = node.first_child;
+    float best_value = -1;
+    for (uint32_t i = node.first_child; i < node.first_child + node.child_count; i++)
+    {
+        float value = puct_value(pool[i], sqrt_parent, MCTS_EXPLORATION);
+        if (value > best_value)
+        {
+            best_value = value;
+            best = i;
+        }
+    }
+    pool[best].visits.fetch_add(MCTS_VIRTUAL_LOSS, std::memory_order_relaxed);
+    return best;
+}
+
+inline Square Engine::mcts_best_move()
+{
+    MctsNode &root = (*mcts_pool)[mcts_root];
+    if (root.expansion.load(std::memory_order_acquire) != MCTS_EXPANDED)
+        return NO_MOVE;
+    uint32_t best = root.first_child;
+    for (uint32_t i = root.first_child; i < root.first_child + root.child_count; i++)
+    {
+        if ((*mcts_pool)[i].visits > (*mcts_pool)[best].visits)
+            best = i;
+    }
+    return (*mcts_pool)[best].move;
+}
+
+// One thread's playouts: select down the tree, expand a leaf visited
+// MCTS_EXPAND_VISITS times, play out randomly from there and back the result
+// up, replacing the virtual losses on the path with the real visit.
+inline void Engine::mcts_worker(const State &root, int thread, std::ostream *progress)
+{
+    MctsPool &pool = *mcts_pool;
+    uint64_t seed = root.hash ^ (uint64_t)(thread + 1) * 0x9E3779B97F4A7C15ULL;
+    uint32_t path[2 * MAX_DEPTH + 8];
+    Square reported = NO_MOVE;
+    for (uint64_t playout = 1; !mcts_finished(); playout++)
+    {
+        if (scheduler && playout % 1024 == 0)
+            checkpoint();
+        State curState = root;
+        int length = 0;
+        uint32_t index = mcts_root;
+        path[length++] = index;
+        pool[index].visits.fetch_add(MCTS_VIRTUAL_LOSS, std::memory_order_relaxed);
+        while (pool[index].expansion.load(std::memory_order_acquire) == MCTS_EXPANDED)
+        {
+            index = mcts_select(pool[index]);
+            path[length++] = index;
+            if (pool[index].move == PASS_MOVE)
+                curState.pass();
+            else
+                curState.put_disc(pool[index].move);
+        }
+
+        Bitboard own = curState.get_bitboard(curState.cur_player);
+        Bitboard opp = curState.get_bitboard(curState.get_next_player(curState.cur_player));
+        // 2, 1 or 0 for the side to move at the leaf
+        int result;
+        if (curState.next_valid_spots.empty() && !move_generator().legal(opp, own))
+        {
+            int diff = bit_count(own) - bit_count(opp);
+            result = diff > 0 ? 2 : diff == 0 ? 1 : 0;
+        }
+        else
+        {
+            MctsNode &leaf = pool[index];
+            uint8_t expected = MCTS_LEAF;
+            if (leaf.visits.load(std::memory_order_relaxed) >= MCTS_VIRTUAL_LOSS + MCTS_EXPAND_VISITS &&
+                leaf.expansion.compare_exchange_strong(expected, MCTS_EXPANDING) && mcts_expand(leaf, curState))
+            {
+                index = mcts_select(leaf);
+                path[length++] = index;
+                if (pool[index].move == PASS_MOVE)
+                    curState.pass();
+                else
+                    curState.put_disc(pool[index].move);
+                own = curState.get_bitboard(curState.cur_player);
+                opp = curState.get_bitboard(curState.get_next_player(curState.cur_player));
+            }
+            result = random_playout(own, opp, seed);
+        }
+
+        // the last node was entered by the other side; sides alternate upwards
+        int score = 2 - result;
+        for (int i = length - 1; i >= 0; i--)
+        {
+            pool[path[i]].visits.fetch_add(1 - MCTS_VIRTUAL_LOSS, std::memory_order_relaxed);
+            pool[path[i]].score.fetch_add(score, std::memory_order_relaxed);
+            score = 2 - score;
+        }
+        mcts_playouts.fetch_add(1, std::memory_order_relaxed);
+
+        if (progress && playout % MCTS_REPORT_PLAYOUTS == 0)
+        {
+            Square best = mcts_best_move();
+            if (best != reported && best != NO_MOVE)
+            {
+                *progress << square_x(best) << " " << square_y(best) << std::endl;
+                progress->flush();
+                reported = best;
+            }
+        }
+    }
+}
+
+// The node two plies below the last search's root (our move, then the reply)
+// whose position is root, or 0 when the tree holds none. Only expanded nodes
+// are followed; a kept subtree is worth nothing without its statistics.
+inline uint32_t Engine::mcts_find_root(const State &root)
+{
+    if (!mcts_root_state || mcts_root_state->cur_player != root.cur_player ||
+        mcts_root_state->disc_count[EMPTY] <= root.disc_count[EMPTY])
+        return 0;
+    MctsPool &pool = *mcts_pool;
+    const MctsNode &last = pool[mcts_root];
+    if (last.expansion.load(std::memory_order_acquire) != MCTS_EXPANDED)
+        return 0;
+    for (uint32_t i = last.first_child; i < last.first_child + last.child_count; i++)
+    {
+        if (pool[i].expansion.load(std::memory_order_acquire) != MCTS_EXPANDED)
+            continue;
+        State ours = *mcts_root_state;
+        if (pool[i].move == PASS_MOVE)
+            ours.pass();
+        else
+            ours.put_disc(pool[i].move);
+        for (uint32_t j = pool[i].first_child; j < pool[i].first_child + pool[i].child_count; j++)
+        {
+            State reply = ours;
+            if (pool[j].move == PASS_MOVE)
+                reply.pass();
+            else
+                reply.put_disc(pool[j].move);
+            if (reply.hash == root.hash)
+                return j;
+        }
+    }
+    return 0;
+}
+
+inline Square Engine::mcts_search(const State &root, std::ostream *progress)
+{
+    if (!mcts_pool)
+        mcts_pool.reset(new MctsPool(MCTS_POOL_NODES));
+    // keep the subtree of the position we predicted, unless the pool is half
+    // spent on abandoned branches
+    uint32_t kept = mcts_pool->size() < MCTS_POOL_NODES / 2 ? mcts_find_root(root) : 0;
+    if (kept)
+    {
+        mcts_root = kept;
+    }
+    else
+    {
+        mcts_pool->reset();
+        mcts_root = 0;
+    }
+    mcts_root_state.reset(new State(root));
+    mcts_playouts = 0;
+    // root children straight away, so every playout starts with a choice
+    MctsNode &top = (*mcts_pool)[mcts_root];
+    if (top.expansion != MCTS_EXPANDED)
+    {
+        top.expansion = MCTS_EXPANDING;
+        mcts_expand(top, root);
+    }
+
+    std::vector<std::thread> workers;
+    for (int t = 1; t < threads; t++)
+        workers.emplace_back(&Engine::mcts_worker, this, std::cref(root), t, nullptr);
+    mcts_worker(root, 0, progress);
+    for (std::thread &worker : workers)
+        worker.join();
+
+    Square best = mcts_best_move();
+    nodes = mcts_playouts;
+    if (show_stats)
+    {
+        int visits = 0, score = 0;
+        for (uint32_t i = top.first_child; i < top.first_child + top.child_count; i++)
+        {
+            if ((*mcts_pool)[i].move == best)
+            {
+                visits = (*mcts_pool)[i].visits;
+                score = (*mcts_pool)[i].score;
+            }
+        }
+        std::cerr << "mcts playouts " << mcts_playouts << " root visits " << top.visits << " reused " << (kept ? "yes" : "no")
+                  << " tree nodes " << mcts_pool->size()
+                  << " best visits " << visits << " win rate " << (visits ? score / (2.0 * visits) : 0)
+                  << " time " << time_manager.elapsed() << " ms" << std::endl;
+    }
+    if (progress)
+    {
+        *progress << square_x(best) << " " << square_y(best) << std::endl;
+        progress->flush();
+    }
+    return best;
+}
+
+// Searches the expected replies to our move with deepening iterations, round
+// robin, until stopped. Results land in ponder_lines and the transposition table.
+inline void Engine::ponder(State afterMove)
+{
+    std::vector<State> positions;
+    if (afterMove.next_valid_spots.empty())
+    {
+        positions.push_back(afterMove);
+        positions.back().pass();
+    }
+    else
+    {
+        MoveList replies = afterMove.next_valid_spots;
+        int sym;
+        const TTEntry *entry = tt.probe(position_key(afterMove, SYMMETRY_HASH, sym));
+        if (entry && entry->move != NO_MOVE)
+            replies.promote(from_stored_move(entry->move, sym));
+        for (int i = 0; i < replies.size() && i < PONDER_REPLIES; i++)
+        {
+            positions.push_back(afterMove);
+            positions.back().put_disc(replies.pick(i));
+        }
+    }
+    ponder_lines.clear();
+    for (const State &position : positions)
+        ponder_lines.push_back(PonderLine{position.hash, 0, NO_MOVE});
+
+    for (int depth = 1; depth <= PONDER_DEPTH; depth++)
+    {
+        for (int i = 0; i < (int)positions.size(); i++)
+        {
+            if (positions[i].next_valid_spots.empty())
+                continue;
+            int value;
+            if (!search_root(positions[i], depth, ponder_lines[i].move, value))
+                return;
+            ponder_lines[i].depth = depth;
+        }
+    }
+}
+
+inline void Engine::start_pondering(const State &root, Square move)
+{
+    stop_pondering();
+    State afterMove = root;
+    afterMove.put_disc(move);
+    // the entries pondering stores belong to the next move's search
+    tt.new_search();
+    pondered = true;
+    ponder_thread = std::thread(&Engine::ponder, this, afterMove);
+}
+
+inline void Engine::stop_pondering()
+{
+    if (!ponder_thread.joinable())
+        return;
+    stop_search = true;
+    ponder_thread.join();
+    stop_search = false;
+}
+
+#endif
@@ -0,0 +1,735 @@
+#ifndef FRONTEND_H
+#define FRONTEND_H
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <cstdlib>
+#include <algorithm>
+#include <chrono>
+#include <sstream>
+#include <string>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <unistd.h>
+
+#include "engine.h"
+#include "position_io.h"
+
+#define BOOK_FILE "book.txt"
+
+// A move request in the game host's file format: the side to move, the board
+// and the legal moves.
+struct Request
+{
+    int player;
+    Grid board;
+    std::vector<Square> valid_spots;
+};
+
+inline void read_board(std::istream &fin, Request &request)
+{
+    fin >> request.player;
+    for (int i = 0; i < SIZE; i++)
+    {
+        for (int j = 0; j < SIZE; j++)
+        {
+            fin >> request.board[i][j];
+        }
+    }
+}
+
+inline void read_valid_spots(std::istream &fin, Request &request)
+{
+    int n_valid_spots;
+    fin >> n_valid_spots;
+    int x, y;
+    request.valid_spots.clear();
+    for (int i = 0; i < n_valid_spots; i++)
+    {
+        fin >> x >> y;
+        request.valid_spots.push_back(to_square(x, y));
+    }
+}
+
+inline void write_valid_spot(Engine &engine, const Request &request, std::ofstream &fout)
+{
+    engine.set_player(request.player);
+    State initState = engine.make_state(request.board, request.player, request.valid_spots);
+    if (initState.next_valid_spots.empty())
+        return;
+    fout << square_x(initState.next_valid_spots.best()) << " " << square_y(initState.next_valid_spots.best()) << std::endl;
+    fout.flush();
+    engine.choose_move(initState, &fout);
+}
+
+// Reads one request in the input file format without parsing it, so it can
+// block while the ponder thread is still searching.
+inline bool read_request(std::istream &in, std::stringstream &request)
+{
+    int token, n_valid_spots;
+    for (int i = 0; i < 1 + SIZE * SIZE; i++)
+    {
+        if (!(in >> token))
+            return false;
+        request << token << " ";
+    }
+    if (!(in >> n_valid_spots))
+        return false;
+    request << n_valid_spots << " ";
+    for (int i = 0; i < 2 * n_valid_spots; i++)
+    {
+        if (!(in >> token))
+            return false;
+        request << token << " ";
+    }
+    return true;
+}
+
+// Long-running mode: reads requests from stdin, answers one move per line on
+// stdout and ponders on the opponent's time in between.
+inline void daemon_loop(Engine &engine)
+{
+    std::stringstream text;
+    Request request;
+    while (read_request(std::cin, text))
+    {
+        engine.stop_pondering();
+        read_board(text, request);
+        read_valid_spots(text, request);
+        text.str("");
+        text.clear();
+
+        engine.set_player(request.player);
+        State initState = engine.make_state(request.board, request.player, request.valid_spots);
+        if (initState.next_valid_spots.empty())
+            continue;
+        Square best = engine.choose_move(initState, nullptr);
+        std::cout << square_x(best) << " " << square_y(best) << std::endl;
+        engine.start_pondering(initState, best);
+    }
+    engine.stop_pondering();
+}
+
+inline State record_state(const Engine &engine, const PositionRecord &rec)
+{
+    Grid board;
+    for (int i = 0; i < SIZE; i++)
+    {
+        for (int j = 0; j < SIZE; j++)
+        {
+            Square sq = to_square(i, j);
+            board[i][j] = (rec.black >> sq) & 1 ? BLACK : (rec.white >> sq) & 1 ? WHITE : EMPTY;
+        }
+    }
+    return engine.make_state(board, rec.player);
+}
+
+// Batch analysis: searches every position of a compact position file and
+// writes it back with the chosen move and score.
+inline void batch(Engine &engine, const char *in_path, const char *out_path)
+{
+    PositionReader reader;
+    PositionWriter writer;
+    if (!reader.open(in_path, format_of(in_path)) || !writer.open(out_path, format_of(out_path)))
+    {
+        std::cerr << "cannot open " << in_path << " or " << out_path << std::endl;
+        return;
+    }
+    PositionRecord rec;
+    while (reader.next(rec))
+    {
+        engine.set_player(rec.player);
+        State curState = record_state(engine, rec);
+        rec.move = NO_MOVE;
+        rec.score = 0;
+        if (!curState.next_valid_spots.empty())
+        {
+            Square best;
+            int value;
+            for (int depth = 1; depth <= DEPTH; depth++)
+                engine.search_root(curState, depth, best, value);
+            rec.move = best;
+            rec.score = std::max(-32767, std::min(32767, value));
+        }
+        writer.write(rec);
+    }
+}
+
+// Evaluation throughput on the children of every position in the file: the
+// hand-written heuristic against the network, including the accumulator
+// updates the network adds to put_disc.
+inline void bench_eval(Engine &engine, const char *path)
+{
+    const int ROUNDS = 20;
+    PositionReader reader;
+    if (!reader.open(path, format_of(path)))
+    {
+        std::cerr << "cannot open " << path << std::endl;
+        return;
+    }
+    std::vector<PositionRecord> records;
+    PositionRecord rec;
+    while (reader.next(rec))
+        records.push_back(rec);
+    if (!engine.has_network())
+    {
+        std::cerr << "no --nnue weights given, timing random ones" << std::endl;
+        engine.use_random_network(20220601);
+    }
+    engine.set_player(BLACK);
+    // time the evaluators themselves, not the cache
+    engine.resize_eval_cache(0);
+    for (int network = 0; network < 2; network++)
+    {
+        engine.set_network_enabled(network == 1);
+        std::vector<State> parents, children;
+        for (const PositionRecord &r : records)
+            parents.push_back(record_state(engine, r));
+        int64_t sink = 0;
+        uint64_t moves = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int round = 0; round < ROUNDS; round++)
+        {
+            for (const State &parent : parents)
+            {
+                for (int i = 0; i < parent.next_valid_spots.size(); i++)
+                {
+                    State child = parent;
+                    child.put_disc(parent.next_valid_spots[i]);
+                    sink += child.hash & 1;
+                    moves++;
+                    if (round == 0)
+                        children.push_back(child);
+                }
+            }
+        }
+        double move_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        start = std::chrono::steady_clock::now();
+        for (int round = 0; round < ROUNDS; round++)
+        {
+            for (const State &child : children)
+                sink += engine.heuristic(child);
+        }
+        double eval_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << (network ? "network  " : "heuristic") << "  put_disc " << (uint64_t)(moves / move_time)
+                  << "/s  eval " << (uint64_t)(children.size() * ROUNDS / eval_time) << "/s  (" << children.size()
+                  << " leaves, checksum " << sink << ")" << std::endl;
+    }
+}
+
+// Positions from random games, as (side to move, opponent) bitboards, for
+// the move generator checks.
+inline void random_positions(int count, std::vector<std::pair<Bitboard, Bitboard>> &positions)
+{
+    uint64_t seed = 20220601;
+    Bitboard own = 0x0000000810000000ULL, opp = 0x0000001008000000ULL;
+    while ((int)positions.size() < count)
+    {
+        Bitboard moves = reference_legal(own, opp);
+        if (!moves)
+        {
+            if (!reference_legal(opp, own))
+            {
+                own = 0x0000000810000000ULL;
+                opp = 0x0000001008000000ULL;
+                continue;
+            }
+            std::swap(own, opp);
+            continue;
+        }
+        positions.push_back({own, opp});
+        int pick = splitmix64(seed) % bit_count(moves);
+        for (; pick; pick--)
+            moves &= moves - 1;
+        Square sq = __builtin_ctzll(moves);
+        Bitboard flipped = reference_flips(own, opp, sq);
+        own |= flipped | 1ULL << sq;
+        opp &= ~flipped;
+        std::swap(own, opp);
+    }
+}
+
+// Differential check of every move generator the CPU supports against the
+// ray-walking reference, then each one's speed in legal-move sets and flip
+// sets per second.
+inline int bench_movegen(int count)
+{
+    const int ROUNDS = 50;
+    std::vector<std::pair<Bitboard, Bitboard>> positions;
+    random_positions(count, positions);
+    std::vector<Bitboard> legal;
+    for (const auto &p : positions)
+        legal.push_back(reference_legal(p.first, p.second));
+    int failures = 0;
+    for (const MoveGenerator &generator : Move_Generators)
+    {
+        if (!generator.supported())
+        {
+            std::cout << generator.name << "  not supported on this CPU" << std::endl;
+            continue;
+        }
+        int mismatches = 0;
+        uint64_t flip_sets = 0;
+        for (size_t i = 0; i < positions.size(); i++)
+        {
+            Bitboard own = positions[i].first, opp = positions[i].second;
+            if (generator.legal(own, opp) != legal[i])
+                mismatches++;
+            for (Bitboard m = legal[i]; m; m &= m - 1)
+            {
+                Square sq = __builtin_ctzll(m);
+                Bitboard flipped = reference_flips(own, opp, sq);
+                if (generator.flips(own, opp, sq) != flipped || generator.flips(own | 1ULL << sq, opp, sq) != flipped)
+                    mismatches++;
+                flip_sets++;
+            }
+        }
+        failures += mismatches;
+
+        Bitboard sink = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int round = 0; round < ROUNDS; round++)
+        {
+            for (const auto &p : positions)
+                sink += generator.legal(p.first, p.second);
+        }
+        double legal_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        start = std::chrono::steady_clock::now();
+        for (int round = 0; round < ROUNDS; round++)
+        {
+            for (size_t i = 0; i < positions.size(); i++)
+            {
+                for (Bitboard m = legal[i]; m; m &= m - 1)
+                    sink += generator.flips(positions[i].first, positions[i].second, __builtin_ctzll(m));
+            }
+        }
+        double flip_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << generator.name << (&generator == &move_generator() ? "*" : " ") << "  legal "
+                  << (uint64_t)(positions.size() * ROUNDS / legal_time) << "/s  flips "
+                  << (uint64_t)(flip_sets * ROUNDS / flip_time) << "/s  " << mismatches << " mismatches  (checksum "
+                  << (sink & 0xFFFF) << ")" << std::endl;
+    }
+    return failures ? 1 : 0;
+}
+
+// Parallel endgame solver scaling: solves each position with 1 up to
+// engine.threads threads, from an empty solve table each time, and prints the
+// time, nodes and speedup over one thread per thread count. The positions come
+// from the file, or are a fixed set of random games at SOLVE_EMPTIES empties.
+// Returns 1 when a thread count disagrees with one thread on any outcome.
+inline int bench_solve(Engine &engine, const char *path)
+{
+    const int FIXED_POSITIONS = 12;
+    std::vector<State> endgames;
+    if (path)
+    {
+        PositionReader reader;
+        if (!reader.open(path, format_of(path)))
+        {
+            std::cerr << "cannot open " << path << std::endl;
+            return 1;
+        }
+        PositionRecord rec;
+        while (reader.next(rec))
+        {
+            engine.set_player(rec.player);
+            endgames.push_back(record_state(engine, rec));
+        }
+    }
+    else
+    {
+        std::vector<std::pair<Bitboard, Bitboard>> positions;
+        random_positions(200000, positions);
+        for (const auto &p : positions)
+        {
+            if ((int)endgames.size() < FIXED_POSITIONS && 64 - bit_count(p.first | p.second) == SOLVE_EMPTIES)
+                endgames.push_back(record_state(engine, PositionRecord{p.first, p.second, BLACK, NO_MOVE, 0, {}}));
+        }
+        engine.set_player(BLACK);
+    }
+    int max_threads = engine.threads, failures = 0;
+    std::vector<int> outcomes;
+    double single = 0;
+    for (int t = 1; t <= max_threads; t++)
+    {
+        engine.threads = t;
+        engine.nodes = 0;
+        double ms = 0;
+        int mismatches = 0;
+        for (size_t i = 0; i < endgames.size(); i++)
+        {
+            const State &root = endgames[i];
+            Square move;
+            int value = 0;
+            if (!root.next_valid_spots.empty())
+            {
+                engine.set_player(root.cur_player);
+                engine.clear_solve_table();
+                auto start = std::chrono::steady_clock::now();
+                engine.solve_root(root, move, value);
+                ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            }
+            if (t == 1)
+                outcomes.push_back(value);
+            else if (outcomes[i] != value)
+                mismatches++;
+        }
+        if (t == 1)
+            single = ms;
+        failures += mismatches;
+        std::cout << "threads " << t << "  time " << ms << " ms  nodes " << engine.nodes << "  nps "
+                  << (uint64_t)(engine.nodes / std::max(ms, 1e-3) * 1000) << "  speedup " << single / std::max(ms, 1e-3)
+                  << "  " << mismatches << " mismatches" << std::endl;
+    }
+    return failures ? 1 : 0;
+}
+
+// --time <ms> remaining on our clock, --inc <ms> added per move, --movetime <ms>
+// per-move cap, --stats prints search counters to stderr, --nnue <file> loads
+// network weights to evaluate with, --eval-cache <bits> sizes the evaluation
+// cache (0 turns it off), --threads <n> sets the endgame solver's threads,
+// --movegen <name> overrides the move generator picked for this CPU,
+// --leaf-batch 0 evaluates depth-1 children one at a time, --mcts searches
+// with Monte Carlo tree search until the endgame solver takes over
+inline void parse_options(Engine &engine, int argc, char **argv, int first)
+{
+    for (int i = first; i < argc; i++)
+    {
+        std::string option = argv[i];
+        if (option == "--stats")
+            engine.show_stats = true;
+        else if (option == "--mcts")
+            engine.use_mcts = true;
+        else if (i + 1 == argc)
+            break;
+        else if (option == "--time")
+            engine.remaining_time = std::atof(argv[++i]);
+        else if (option == "--inc")
+            engine.increment = std::atof(argv[++i]);
+        else if (option == "--movetime")
+            engine.move_time = std::atof(argv[++i]);
+        else if (option == "--threads")
+            engine.threads = std::max(1, std::atoi(argv[++i]));
+        else if (option == "--eval-cache")
+            engine.resize_eval_cache(std::atoi(argv[++i]));
+        else if (option == "--leaf-batch")
+            engine.batch_leaves = std::atoi(argv[++i]) != 0;
+        else if (option == "--movegen")
+        {
+            if (!select_move_generator(argv[++i]))
+                std::cerr << "move generator " << argv[i] << " unavailable, using " << move_generator().name << std::endl;
+        }
+        else if (option == "--nnue")
+        {
+            if (!engine.load_network(argv[++i]))
+                std::cerr << "cannot load network " << argv[i] << ", using the heuristic" << std::endl;
+        }
+    }
+}
+
+// One recorded request and what the replay made of it.
+struct ReplayResult
+{
+    std::string name;
+    int empties;
+    Square move;
+    double ms;
+    uint64_t nodes;
+    int depth;
+    Square other_move; // the compared binary's answer, NO_MOVE if none
+    double other_ms;
+};
+
+// Requests in the input file format from every file of a directory, in name
+// order, or from a single log file holding any number of them back to back.
+inline std::vector<std::pair<std::string, std::string>> read_recorded_requests(const char *path)
+{
+    std::vector<std::string> files;
+    if (std::filesystem::is_directory(path))
+    {
+        for (const auto &entry : std::filesystem::directory_iterator(path))
+        {
+            if (entry.is_regular_file())
+                files.push_back(entry.path().string());
+        }
+        std::sort(files.begin(), files.end());
+    }
+    else
+    {
+        files.push_back(path);
+    }
+    std::vector<std::pair<std::string, std::string>> requests;
+    for (const std::string &file : files)
+    {
+        std::ifstream in(file);
+        std::stringstream text;
+        for (int k = 0; read_request(in, text); k++)
+        {
+            requests.push_back({k ? file + "#" + std::to_string(k) : file, text.str()});
+            text.str("");
+            text.clear();
+        }
+    }
+    return requests;
+}
+
+// Runs another engine binary on one request in file mode, the way the game
+// host does; returns its last answer and the wall time in ms.
+inline Square run_other_binary(const std::string &binary, const std::string &request, const std::string &options, double &ms)
+{
+    std::string base = (std::filesystem::temp_directory_path() / ("replay_" + std::to_string(getpid()))).string();
+    std::string in_path = base + ".in", out_path = base + ".out";
+    std::ofstream(in_path) << request << std::endl;
+    std::remove(out_path.c_str());
+    std::string command = "\"" + binary + "\" \"" + in_path + "\" \"" + out_path + "\"" + options + " > /dev/null 2>&1";
+    auto start = std::chrono::steady_clock::now();
+    int status = std::system(command.c_str());
+    ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    Square move = NO_MOVE;
+    std::ifstream out(out_path);
+    int x, y;
+    while (status == 0 && out >> x >> y)
+        move = to_square(x, y);
+    std::remove(in_path.c_str());
+    std::remove(out_path.c_str());
+    return move;
+}
+
+inline std::string square_name(Square sq)
+{
+    return sq == NO_MOVE ? "-" : std::to_string(square_x(sq)) + " " + std::to_string(square_y(sq));
+}
+
+// Replays recorded requests as production would see them, a fresh engine per
+// request with the given options, and reports latency, nodes, completed depth
+// and move for each, then the slowest ones and, with --compare <binary>, the
+// positions where the other binary answers differently.
+inline int replay(const Weights &weights, const char *path, int argc, char **argv, int first)
+{
+    const int WORST = 10;
+    std::string other, options;
+    for (int i = first; i < argc; i++)
+    {
+        if (std::string(argv[i]) == "--compare" && i + 1 < argc)
+            other = argv[++i];
+        else
+            options += std::string(" ") + argv[i];
+    }
+    std::vector<std::pair<std::string, std::string>> requests = read_recorded_requests(path);
+    if (requests.empty())
+    {
+        std::cerr << "no requests in " << path << std::endl;
+        return 1;
+    }
+    std::vector<ReplayResult> results;
+    for (const auto &recorded : requests)
+    {
+        Engine engine(weights);
+        engine.load_book(BOOK_FILE);
+        parse_options(engine, argc, argv, first);
+        std::stringstream text(recorded.second);
+        Request request;
+        read_board(text, request);
+        read_valid_spots(text, request);
+        engine.set_player(request.player);
+        State initState = engine.make_state(request.board, request.player, request.valid_spots);
+        ReplayResult result{recorded.first, initState.disc_count[EMPTY], NO_MOVE, 0, 0, 0, NO_MOVE, 0};
+        if (!initState.next_valid_spots.empty())
+        {
+            auto start = std::chrono::steady_clock::now();
+            result.move = engine.choose_move(initState, nullptr);
+            result.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            result.nodes = engine.nodes;
+            result.depth = engine.depth_reached;
+        }
+        if (!other.empty())
+            result.other_move = run_other_binary(other, recorded.second, options, result.other_ms);
+        std::cout << result.name << "  empties " << result.empties << "  move " << square_name(result.move)
+                  << "  " << result.ms << " ms  nodes " << result.nodes << "  depth " << result.depth;
+        if (!other.empty())
+            std::cout << "  other " << square_name(result.other_move) << "  " << result.other_ms << " ms";
+        std::cout << std::endl;
+        results.push_back(result);
+    }
+
+    std::vector<ReplayResult> slowest = results;
+    std::sort(slowest.begin(), slowest.end(), [](const ReplayResult &a, const ReplayResult &b) { return a.ms > b.ms; });
+    double total = 0;
+    for (const ReplayResult &r : results)
+        total += r.ms;
+    std::cout << std::endl
+              << results.size() << " positions, " << total << " ms total, slowest:" << std::endl;
+    for (int i = 0; i < (int)slowest.size() && i < WORST; i++)
+    {
+        std::cout << "  " << slowest[i].ms << " ms  " << slowest[i].name << "  empties " << slowest[i].empties
+                  << "  depth " << slowest[i].depth << std::endl;
+    }
+    if (!other.empty())
+    {
+        int differing = 0;
+        for (const ReplayResult &r : results)
+        {
+            if (r.move != r.other_move)
+            {
+                if (differing++ == 0)
+                    std::cout << "moves differing from " << other << ":" << std::endl;
+                std::cout << "  " << r.name << "  " << square_name(r.move) << " vs " << square_name(r.other_move) << std::endl;
+            }
+        }
+        std::cout << differing << " of " << results.size() << " moves differ" << std::endl;
+    }
+    return 0;
+}
+
+// One game of a hosting process: its own engine, tables and clock.
+struct HostedGame
+{
+    std::unique_ptr<Engine> engine;
+    std::mutex busy; // one request of a game at a time
+};
+
+// Answers one hosted request: waits for a core, searches with the clock
+// reduced by the wait and prints "<id> x y".
+inline void host_move(HostedGame &game, const std::string &id, const std::string &text, double arrival,
+                      CoreScheduler &scheduler, std::mutex &output)
+{
+    std::lock_guard<std::mutex> held(game.busy);
+    Engine &engine = *game.engine;
+    std::stringstream in(text);
+    Request request;
+    read_board(in, request);
+    read_valid_spots(in, request);
+    engine.set_player(request.player);
+    State initState = engine.make_state(request.board, request.player, request.valid_spots);
+    if (initState.next_valid_spots.empty())
+        return;
+    // the game whose clock or move limit runs out first is the most urgent
+    double budget = 1e9;
+    if (engine.remaining_time > 0)
+        budget = engine.remaining_time;
+    if (engine.move_time > 0)
+        budget = std::min(budget, engine.move_time);
+    scheduler.begin(&engine, arrival + budget);
+    double waited = CoreScheduler::now() - arrival, move_time = engine.move_time;
+    if (engine.remaining_time > 0)
+        engine.remaining_time = std::max(1.0, engine.remaining_time - waited);
+    if (move_time > 0)
+        engine.move_time = std::max(1.0, move_time - waited);
+    Square best = engine.choose_move(initState, nullptr);
+    engine.move_time = move_time;
+    scheduler.end(&engine);
+    std::lock_guard<std::mutex> printing(output);
+    std::cout << id << " " << square_x(best) << " " << square_y(best) << std::endl;
+}
+
+// Hosts many games in one process. Each request on stdin is the usual input
+// format preceded by a game id and is answered with "<id> x y" once searched.
+// Every game gets its own engine with the given options; --cores <n> searches
+// run at a time, scheduled by CoreScheduler by how soon each game's clock
+// runs out, while the other searches sleep instead of competing for the CPU.
+inline int host_loop(const Weights &weights, int argc, char **argv, int first)
+{
+    int cores = std::max(1u, std::thread::hardware_concurrency());
+    for (int i = first; i + 1 < argc; i++)
+    {
+        if (std::string(argv[i]) == "--cores")
+            cores = std::max(1, std::atoi(argv[i + 1]));
+    }
+    CoreScheduler scheduler(cores);
+    std::map<std::string, HostedGame> games;
+    std::mutex output, finished_lock;
+    std::condition_variable finished;
+    int in_flight = 0;
+    std::string id;
+    std::stringstream text;
+    while (std::cin >> id && read_request(std::cin, text))
+    {
+        double arrival = CoreScheduler::now();
+        HostedGame &game = games[id];
+        if (!game.engine)
+        {
+            game.engine.reset(new Engine(weights));
+            game.engine->load_book(BOOK_FILE);
+            parse_options(*game.engine, argc, argv, first);
+            game.engine->threads = 1;
+            game.engine->scheduler = &scheduler;
+        }
+        {
+            std::lock_guard<std::mutex> held(finished_lock);
+            in_flight++;
+        }
+        std::thread([&, id, request = text.str(), arrival, game_ptr = &game] {
+            host_move(*game_ptr, id, request, arrival, scheduler, output);
+            std::lock_guard<std::mutex> held(finished_lock);
+            in_flight--;
+            finished.notify_all();
+        }).detach();
+        text.str("");
+        text.clear();
+    }
+    std::unique_lock<std::mutex> held(finished_lock);
+    finished.wait(held, [&] { return in_flight == 0; });
+    return 0;
+}
+
+// Entry point shared by the players, which differ only in their weights.
+inline int run(int argc, char **argv, const Weights &weights)
+{
+    Engine engine(weights);
+    if (argc > 1 && std::string(argv[1]) == "--daemon")
+    {
+        engine.load_book(BOOK_FILE);
+        parse_options(engine, argc, argv, 2);
+        daemon_loop(engine);
+        return 0;
+    }
+    if (argc > 3 && std::string(argv[1]) == "--batch")
+    {
+        engine.load_book(BOOK_FILE);
+        parse_options(engine, argc, argv, 4);
+        batch(engine, argv[2], argv[3]);
+        return 0;
+    }
+    if (argc > 2 && std::string(argv[1]) == "--bench-eval")
+    {
+        parse_options(engine, argc, argv, 3);
+        bench_eval(engine, argv[2]);
+        return 0;
+    }
+    if (argc > 1 && std::string(argv[1]) == "--host")
+        return host_loop(weights, argc, argv, 2);
+    if (argc > 2 && std::string(argv[1]) == "--replay")
+        return replay(weights, argv[2], argc, argv, 3);
+    if (argc > 1 && std::string(argv[1]) == "--bench-solve")
+    {
+        // every core unless --threads says otherwise
+        engine.threads = std::max(1u, std::thread::hardware_concurrency());
+        bool has_path = argc > 2 && argv[2][0] != '-';
+        parse_options(engine, argc, argv, has_path ? 3 : 2);
+        return bench_solve(engine, has_path ? argv[2] : nullptr);
+    }
+    if (argc > 1 && std::string(argv[1]) == "--bench-movegen")
+    {
+        bool has_count = argc > 2 && std::isdigit((unsigned char)argv[2][0]);
+        parse_options(engine, argc, argv, has_count ? 3 : 2);
+        return bench_movegen(has_count ? std::max(1, std::atoi(argv[2])) : 100000);
+    }
+    std::ifstream fin(argv[1]);
+    std::ofstream fout(argv[2]);
+    engine.load_book(BOOK_FILE);
+    parse_options(engine, argc, argv, 3);
+    Request request;
+    read_board(fin, request);
+    read_valid_spots(fin, request);
+    write_valid_spot(engine, request, fout);
+    fin.close();
+    fout.close();
+    return 0;
+}
+
+#endif
@@ -0,0 +1,131 @@
+#ifndef MCTS_H
+#define MCTS_H
+
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+
+#include "bitboard.h"
+#include "movegen.h"
+#include "squares.h"
+#include "transposition.h"
+
+// move of the single child of a position whose side to move must pass
+const Square PASS_MOVE = 64;
+
+enum MCTS_EXPANSION
+{
+    MCTS_LEAF = 0,
+    MCTS_EXPANDING = 1,
+    MCTS_EXPANDED = 2
+};
+
+// One position of the Monte Carlo tree, reached by `move`. visits and score
+// are seen from the side that played `move`: a win scores 2, a draw 1.
+// visits also counts the virtual losses of playouts still running below.
+// The children are a contiguous block of the pool, written by the thread that
+// expands the node and published by setting expansion to MCTS_EXPANDED.
+struct MctsNode
+{
+    std::atomic<int32_t> visits{0};
+    std::atomic<int32_t> score{0};
+    std::atomic<uint8_t> expansion{MCTS_LEAF};
+    uint32_t first_child = 0;
+    uint8_t child_count = 0;
+    Square move = PASS_MOVE;
+    float prior = 0;
+
+    void reset(Square sq, float p)
+    {
+        visits.store(0, std::memory_order_relaxed);
+        score.store(0, std::memory_order_relaxed);
+        expansion.store(MCTS_LEAF, std::memory_order_relaxed);
+        child_count = 0;
+        move = sq;
+        prior = p;
+    }
+};
+
+// Fixed arena of nodes handed out by an atomic bump pointer, so threads grow
+// the tree without locks. Node 0 is the root; reset() drops the whole tree.
+class MctsPool
+{
+private:
+    std::unique_ptr<MctsNode[]> nodes;
+    uint32_t capacity;
+    std::atomic<uint32_t> used;
+
+public:
+    explicit MctsPool(uint32_t size) : nodes(new MctsNode[size]), capacity(size), used(1)
+    {
+    }
+    MctsNode &operator[](uint32_t index)
+    {
+        return nodes[index];
+    }
+    uint32_t size() const
+    {
+        return used.load(std::memory_order_relaxed);
+    }
+    // first index of count fresh nodes, or 0 once the pool is spent
+    uint32_t allocate(int count)
+    {
+        if (used.load(std::memory_order_relaxed) + count > capacity)
+            return 0;
+        uint32_t first = used.fetch_add(count, std::memory_order_relaxed);
+        if (first + count > capacity)
+            return 0;
+        return first;
+    }
+    void reset()
+    {
+        used = 1;
+        nodes[0].reset(PASS_MOVE, 1);
+    }
+};
+
+// PUCT: the child's mean score (0.5 until visited) plus an exploration bonus
+// led by its prior. Virtual losses in visits steer other threads elsewhere.
+inline float puct_value(const MctsNode &child, float sqrt_parent, float exploration)
+{
+    int visits = child.visits.load(std::memory_order_relaxed);
+    float mean = visits > 0 ? child.score.load(std::memory_order_relaxed) / (2.0f * visits) : 0.5f;
+    return mean + exploration * child.prior * sqrt_parent / (1 + visits);
+}
+
+// Plays uniformly random moves to the end of the game on bitboards with the
+// active move generator. Returns 2, 1 or 0 as the side to move at the start
+// wins, draws or loses.
+inline int random_playout(Bitboard own, Bitboard opp, uint64_t &seed)
+{
+    const MoveGenerator &generator = move_generator();
+    bool flipped_sides = false;
+    int passes = 0;
+    while (passes < 2)
+    {
+        Bitboard moves = generator.legal(own, opp);
+        if (moves)
+        {
+            passes = 0;
+            for (int pick = splitmix64(seed) % bit_count(moves); pick; pick--)
+                moves &= moves - 1;
+            Square sq = __builtin_ctzll(moves);
+            Bitboard flips = generator.flips(own, opp, sq);
+            own |= flips | 1ULL << sq;
+            opp &= ~flips;
+        }
+        else
+        {
+            passes++;
+        }
+        std::swap(own, opp);
+        flipped_sides = !flipped_sides;
+    }
+    int diff = bit_count(own) - bit_count(opp);
+    if (flipped_sides)
+        diff = -diff;
+    return diff > 0 ? 2 : diff == 0 ? 1 : 0;
+}
+
+#endif
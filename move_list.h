@@ -0,0 +1,105 @@
+#ifndef MOVE_LIST_H
+#define MOVE_LIST_H
+
+#include <cstdint>
+#include <utility>
+
+#include "squares.h"
+
+// Reachable positions have at most 33 legal moves; 60 covers any board.
+const int MAX_MOVES = 60;
+
+struct ScoredMove
+{
+    Square sq;
+    int16_t score;
+};
+
+// Fixed-capacity move list kept inline, so copying a State never allocates.
+// Moves are stored unordered; pick(i) selects the i-th best on demand, so a
+// search that cuts off after the first moves never pays for a full sort.
+class MoveList
+{
+private:
+    ScoredMove moves[MAX_MOVES];
+    int count;
+
+public:
+    MoveList() : count(0) {}
+    MoveList(const MoveList &rhs) : count(rhs.count)
+    {
+        for (int i = 0; i < count; i++)
+            moves[i] = rhs.moves[i];
+    }
+    MoveList &operator=(const MoveList &rhs)
+    {
+        count = rhs.count;
+        for (int i = 0; i < count; i++)
+            moves[i] = rhs.moves[i];
+        return *this;
+    }
+    int size() const
+    {
+        return count;
+    }
+    bool empty() const
+    {
+        return count == 0;
+    }
+    void clear()
+    {
+        count = 0;
+    }
+    void push(Square sq, int score)
+    {
+        moves[count++] = ScoredMove{sq, (int16_t)score};
+    }
+    // i-th move in storage order
+    Square operator[](int i) const
+    {
+        return moves[i].sq;
+    }
+    bool contains(Square sq) const
+    {
+        for (int i = 0; i < count; i++)
+        {
+            if (moves[i].sq == sq)
+                return true;
+        }
+        return false;
+    }
+    // Moves the best remaining move into slot i and returns it. Calling it
+    // with i = 0, 1, 2, ... visits the moves from best to worst.
+    Square pick(int i)
+    {
+        int best = i;
+        for (int j = i + 1; j < count; j++)
+        {
+            if (moves[j].score > moves[best].score)
+                best = j;
+        }
+        std::swap(moves[i], moves[best]);
+        return moves[i].sq;
+    }
+    Square best() const
+    {
+        int best = 0;
+        for (int j = 1; j < count; j++)
+        {
+            if (moves[j].score > moves[best].score)
+                best = j;
+        }
+        return moves[best].sq;
+    }
+    // makes sq the first move picked, e.g. the move from the transposition table
+    void promote(Square sq)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            if (moves[i].sq == sq)
+                moves[i].score = INT16_MAX;
+        }
+    }
+};
+
+#endif
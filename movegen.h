@@ -0,0 +1,323 @@
+#ifndef MOVEGEN_H
+#define MOVEGEN_H
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+#include <immintrin.h>
+
+#include "bitboard.h"
+#include "squares.h"
+
+// Interchangeable legal-move and flip generators on bitboards. All of them
+// compute the same sets; which one is fastest depends on the machine, so the
+// backend is chosen once at startup (move_generator()) and can be overridden
+// by name before any search starts.
+struct MoveGenerator
+{
+    const char *name;
+    bool (*supported)();
+    Bitboard (*legal)(Bitboard own, Bitboard opp);
+    // own may or may not include sq already: put_disc places the disc first
+    Bitboard (*flips)(Bitboard own, Bitboard opp, Square sq);
+};
+
+inline bool always_supported()
+{
+    return true;
+}
+
+// Reference implementation walking Square_Tables rays one direction at a
+// time, as State did before; the other backends are checked against it.
+inline Bitboard reference_flips(Bitboard own, Bitboard opp, Square sq)
+{
+    Bitboard flipped = 0;
+    for (int d = 0; d < 8; d++)
+    {
+        const Square *ray = Square_Tables.ray[sq][d];
+        int length = Square_Tables.edge_distance[sq][d];
+        int k = 0;
+        while (k < length && ((opp >> ray[k]) & 1))
+            k++;
+        if (k == 0 || k == length || !((own >> ray[k]) & 1))
+            continue;
+        for (int i = 0; i < k; i++)
+            flipped |= 1ULL << ray[i];
+    }
+    return flipped;
+}
+
+inline Bitboard reference_legal(Bitboard own, Bitboard opp)
+{
+    Bitboard moves = 0;
+    for (int sq = 0; sq < 64; sq++)
+    {
+        if (!(((own | opp) >> sq) & 1) && reference_flips(own, opp, sq))
+            moves |= 1ULL << sq;
+    }
+    return moves;
+}
+
+// Scalar bitboards: each of the 8 directions is a shift; squares that would
+// wrap around the board edge are masked out of the opponent discs a run may
+// pass through.
+const int DIRECTION_SHIFT[4] = {1, 8, 7, 9}; // y + 1, x + 1, x + 1 and y - 1, x + 1 and y + 1
+const Bitboard DIRECTION_MASK[4] = {~(COL_0 | COL_7), ~0ULL, ~(COL_0 | COL_7), ~(COL_0 | COL_7)};
+
+inline Bitboard scalar_legal(Bitboard own, Bitboard opp)
+{
+    Bitboard moves = 0;
+    for (int d = 0; d < 4; d++)
+    {
+        int s = DIRECTION_SHIFT[d];
+        Bitboard pro = opp & DIRECTION_MASK[d];
+        Bitboard l = pro & (own << s), r = pro & (own >> s);
+        for (int i = 0; i < 5; i++)
+        {
+            l |= pro & (l << s);
+            r |= pro & (r >> s);
+        }
+        moves |= l << s | r >> s;
+    }
+    return moves & ~(own | opp);
+}
+
+inline Bitboard scalar_flips(Bitboard own, Bitboard opp, Square sq)
+{
+    Bitboard m = 1ULL << sq, flipped = 0;
+    for (int d = 0; d < 4; d++)
+    {
+        int s = DIRECTION_SHIFT[d];
+        Bitboard pro = opp & DIRECTION_MASK[d];
+        Bitboard l = 0, r = 0, x;
+        for (x = (m << s) & pro; x; x = (x << s) & pro)
+            l |= x;
+        if ((l << s) & own)
+            flipped |= l;
+        for (x = (m >> s) & pro; x; x = (x >> s) & pro)
+            r |= x;
+        if ((r >> s) & own)
+            flipped |= r;
+    }
+    return flipped;
+}
+
+// AVX2: the four shift directions side by side in one vector, each filled with
+// a Kogge-Stone occluded fill (steps of 1, 2 and 4 squares).
+inline bool avx2_supported()
+{
+    return __builtin_cpu_supports("avx2");
+}
+
+__attribute__((target("avx2"))) inline Bitboard avx2_or_lanes(__m256i v)
+{
+    __m128i x = _mm_or_si128(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+    x = _mm_or_si128(x, _mm_unpackhi_epi64(x, x));
+    return _mm_cvtsi128_si64(x);
+}
+
+__attribute__((target("avx2"))) inline Bitboard avx2_legal(Bitboard own, Bitboard opp)
+{
+    const __m256i s1 = _mm256_set_epi64x(9, 7, 8, 1);
+    const __m256i s2 = _mm256_add_epi64(s1, s1);
+    const __m256i s4 = _mm256_add_epi64(s2, s2);
+    const __m256i mask = _mm256_set_epi64x(DIRECTION_MASK[3], DIRECTION_MASK[2], DIRECTION_MASK[1], DIRECTION_MASK[0]);
+    __m256i own4 = _mm256_set1_epi64x(own);
+    __m256i pro = _mm256_and_si256(_mm256_set1_epi64x(opp), mask);
+
+    __m256i gen = own4, p = pro;
+    gen = _mm256_or_si256(gen, _mm256_and_si256(p, _mm256_sllv_epi64(gen, s1)));
+    p = _mm256_and_si256(p, _mm256_sllv_epi64(p, s1));
+    gen = _mm256_or_si256(gen, _mm256_and_si256(p, _mm256_sllv_epi64(gen, s2)));
+    p = _mm256_and_si256(p, _mm256_sllv_epi64(p, s2));
+    gen = _mm256_or_si256(gen, _mm256_and_si256(p, _mm256_sllv_epi64(gen, s4)));
+    __m256i moves = _mm256_sllv_epi64(_mm256_andnot_si256(own4, gen), s1);
+
+    gen = own4;
+    p = pro;
+    gen = _mm256_or_si256(gen, _mm256_and_si256(p, _mm256_srlv_epi64(gen, s1)));
+    p = _mm256_and_si256(p, _mm256_srlv_epi64(p, s1));
+    gen = _mm256_or_si256(gen, _mm256_and_si256(p, _mm256_srlv_epi64(gen, s2)));
+    p = _mm256_and_si256(p, _mm256_srlv_epi64(p, s2));
+    gen = _mm256_or_si256(gen, _mm256_and_si256(p, _mm256_srlv_epi64(gen, s4)));
+    moves = _mm256_or_si256(moves, _mm256_srlv_epi64(_mm256_andnot_si256(own4, gen), s1));
+
+    return avx2_or_lanes(moves) & ~(own | opp);
+}
+
+__attribute__((target("avx2"))) inline Bitboard avx2_flips(Bitboard own, Bitboard opp, Square sq)
+{
+    const __m256i s1 = _mm256_set_epi64x(9, 7, 8, 1);
+    const __m256i s2 = _mm256_add_epi64(s1, s1);
+    const __m256i s4 = _mm256_add_epi64(s2, s2);
+    const __m256i mask = _mm256_set_epi64x(DIRECTION_MASK[3], DIRECTION_MASK[2], DIRECTION_MASK[1], DIRECTION_MASK[0]);
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i m4 = _mm256_set1_epi64x(1ULL << sq);
+    __m256i own4 = _mm256_set1_epi64x(own);
+    __m256i pro = _mm256_and_si256(_mm256_set1_epi64x(opp), mask);
+
+    // runs of opponent discs from the move, kept where own disc closes them
+    __m256i gen = m4, p = pro;
+    gen = _mm256_or_si256(gen, _mm256_and_si256(p, _mm256_sllv_epi64(gen, s1)));
+    p = _mm256_and_si256(p, _mm256_sllv_epi64(p, s1));
+    gen = _mm256_or_si256(gen, _mm256_and_si256(p, _mm256_sllv_epi64(gen, s2)));
+    p = _mm256_and_si256(p, _mm256_sllv_epi64(p, s2));
+    gen = _mm256_or_si256(gen, _mm256_and_si256(p, _mm256_sllv_epi64(gen, s4)));
+    __m256i run = _mm256_andnot_si256(m4, gen);
+    __m256i open = _mm256_cmpeq_epi64(_mm256_and_si256(_mm256_sllv_epi64(run, s1), own4), zero);
+    __m256i flipped = _mm256_andnot_si256(open, run);
+
+    gen = m4;
+    p = pro;
+    gen = _mm256_or_si256(gen, _mm256_and_si256(p, _mm256_srlv_epi64(gen, s1)));
+    p = _mm256_and_si256(p, _mm256_srlv_epi64(p, s1));
+    gen = _mm256_or_si256(gen, _mm256_and_si256(p, _mm256_srlv_epi64(gen, s2)));
+    p = _mm256_and_si256(p, _mm256_srlv_epi64(p, s2));
+    gen = _mm256_or_si256(gen, _mm256_and_si256(p, _mm256_srlv_epi64(gen, s4)));
+    run = _mm256_andnot_si256(m4, gen);
+    open = _mm256_cmpeq_epi64(_mm256_and_si256(_mm256_srlv_epi64(run, s1), own4), zero);
+    flipped = _mm256_or_si256(flipped, _mm256_andnot_si256(open, run));
+
+    return avx2_or_lanes(flipped);
+}
+
+// Line lookup: every row, column and diagonal is gathered into an 8-bit index
+// (bit i is the square at position i along the line) and the flips along it
+// come from a table indexed by the move's position and both patterns.
+struct LineTables
+{
+    uint8_t flips[8][256][256]; // [position][own][opp]
+    uint8_t moves[256][256];    // [own][opp] legal positions on a line
+    Bitboard column_spread[256]; // bit x of the index to square (x, 0)
+
+    LineTables()
+    {
+        for (int own = 0; own < 256; own++)
+        {
+            for (int opp = 0; opp < 256; opp++)
+            {
+                moves[own][opp] = 0;
+                for (int pos = 0; pos < 8; pos++)
+                {
+                    uint8_t f = 0;
+                    // own may already hold the move square (see MoveGenerator)
+                    if (!(opp >> pos & 1) && !(own & opp))
+                    {
+                        for (int dir = -1; dir <= 1; dir += 2)
+                        {
+                            uint8_t run = 0;
+                            int i = pos + dir;
+                            while (0 <= i && i < 8 && (opp >> i & 1))
+                            {
+                                run |= 1 << i;
+                                i += dir;
+                            }
+                            if (run && 0 <= i && i < 8 && (own >> i & 1))
+                                f |= run;
+                        }
+                    }
+                    flips[pos][own][opp] = f;
+                    if (f)
+                        moves[own][opp] |= 1 << pos;
+                }
+            }
+        }
+        for (int v = 0; v < 256; v++)
+        {
+            column_spread[v] = 0;
+            for (int x = 0; x < 8; x++)
+            {
+                if (v >> x & 1)
+                    column_spread[v] |= 1ULL << (x * 8);
+            }
+        }
+    }
+};
+
+inline const LineTables &line_tables()
+{
+    static const std::unique_ptr<LineTables> tables(new LineTables());
+    return *tables;
+}
+
+inline int row_index(Bitboard b, int x)
+{
+    return (b >> (x * 8)) & 0xFF;
+}
+inline int column_index(Bitboard b, int y)
+{
+    return (((b >> y) & COL_0) * 0x0102040810204080ULL) >> 56;
+}
+// diagonals hold one square per row, at distinct y: adding up the rows packs
+// them into one byte indexed by y
+inline int diagonal_index(Bitboard b, Bitboard line)
+{
+    return ((b & line) * COL_0) >> 56;
+}
+
+inline Bitboard lut_legal(Bitboard own, Bitboard opp)
+{
+    const LineTables &t = line_tables();
+    Bitboard moves = 0;
+    for (int i = 0; i < 8; i++)
+    {
+        moves |= (Bitboard)t.moves[row_index(own, i)][row_index(opp, i)] << (i * 8);
+        moves |= t.column_spread[t.moves[column_index(own, i)][column_index(opp, i)]] << i;
+    }
+    for (int i = 0; i < 15; i++)
+    {
+        Bitboard diag = Diagonal_Masks.diag[i], anti = Diagonal_Masks.anti[i];
+        moves |= (t.moves[diagonal_index(own, diag)][diagonal_index(opp, diag)] * COL_0) & diag;
+        moves |= (t.moves[diagonal_index(own, anti)][diagonal_index(opp, anti)] * COL_0) & anti;
+    }
+    return moves & ~(own | opp);
+}
+
+inline Bitboard lut_flips(Bitboard own, Bitboard opp, Square sq)
+{
+    const LineTables &t = line_tables();
+    int x = square_x(sq), y = square_y(sq);
+    Bitboard diag = Diagonal_Masks.diag[x - y + 7], anti = Diagonal_Masks.anti[x + y];
+    Bitboard flipped = (Bitboard)t.flips[y][row_index(own, x)][row_index(opp, x)] << (x * 8);
+    flipped |= t.column_spread[t.flips[x][column_index(own, y)][column_index(opp, y)]] << y;
+    flipped |= (t.flips[y][diagonal_index(own, diag)][diagonal_index(opp, diag)] * COL_0) & diag;
+    flipped |= (t.flips[y][diagonal_index(own, anti)][diagonal_index(opp, anti)] * COL_0) & anti;
+    return flipped;
+}
+
+const MoveGenerator Move_Generators[] = {
+    {"scalar", always_supported, scalar_legal, scalar_flips},
+    {"avx2", avx2_supported, avx2_legal, avx2_flips},
+    {"lut", always_supported, lut_legal, lut_flips},
+};
+const int MOVE_GENERATORS = sizeof(Move_Generators) / sizeof(Move_Generators[0]);
+
+inline const MoveGenerator *&active_move_generator()
+{
+    // CPUID decides the default: AVX2 where the CPU has it
+    static const MoveGenerator *active = avx2_supported() ? &Move_Generators[1] : &Move_Generators[0];
+    return active;
+}
+
+inline const MoveGenerator &move_generator()
+{
+    return *active_move_generator();
+}
+
+// Overrides the startup choice; call before any search runs. False when the
+// name is unknown or the CPU lacks the instructions.
+inline bool select_move_generator(const char *name)
+{
+    for (const MoveGenerator &generator : Move_Generators)
+    {
+        if (strcmp(generator.name, name) == 0 && generator.supported())
+        {
+            active_move_generator() = &generator;
+            return true;
+        }
+    }
+    return false;
+}
+
+#endif
@@ -0,0 +1,179 @@
+#ifndef NNUE_H
+#define NNUE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+#include <immintrin.h>
+
+#include "movegen.h"
+#include "transposition.h"
+
+// Small efficiently-updatable evaluation network. The inputs are one feature
+// per square and disc colour; the first layer is kept as an accumulator that
+// the board updates square by square, so a move costs one row per changed
+// disc. The hidden layer is clipped to [0, 127] and read out by a single
+// int8 dot product. Scores are from black's side, in heuristic() units.
+const int NNUE_INPUTS = 128; // (disc - 1) * 64 + square
+const int NNUE_HIDDEN = 32;
+
+struct Accumulator
+{
+    alignas(32) int16_t v[NNUE_HIDDEN];
+};
+
+inline int nnue_feature(int disc, int sq)
+{
+    return (disc - 1) * 64 + sq;
+}
+
+// Inference kernels on one accumulator, picked once at startup like the move
+// generators: AVX2 where the CPU has it, whatever flags the tree is built with.
+struct NetworkKernels
+{
+    const char *name;
+    bool (*supported)();
+    void (*update)(int16_t *acc, const int16_t *removed, const int16_t *added); // either may be null
+    int32_t (*output)(const int16_t *acc, const int8_t *weights);
+};
+
+inline void scalar_update(int16_t *acc, const int16_t *removed, const int16_t *added)
+{
+    for (int j = 0; j < NNUE_HIDDEN; j++)
+        acc[j] += (added ? added[j] : 0) - (removed ? removed[j] : 0);
+}
+
+inline int32_t scalar_output(const int16_t *acc, const int8_t *weights)
+{
+    int32_t total = 0;
+    for (int j = 0; j < NNUE_HIDDEN; j++)
+    {
+        int h = acc[j] < 0 ? 0 : acc[j] > 127 ? 127 : acc[j];
+        total += h * weights[j];
+    }
+    return total;
+}
+
+__attribute__((target("avx2"))) inline void avx2_update(int16_t *acc, const int16_t *removed, const int16_t *added)
+{
+    for (int j = 0; j < NNUE_HIDDEN; j += 16)
+    {
+        __m256i a = _mm256_load_si256((const __m256i *)(acc + j));
+        if (removed)
+            a = _mm256_sub_epi16(a, _mm256_load_si256((const __m256i *)(removed + j)));
+        if (added)
+            a = _mm256_add_epi16(a, _mm256_load_si256((const __m256i *)(added + j)));
+        _mm256_store_si256((__m256i *)(acc + j), a);
+    }
+}
+
+__attribute__((target("avx2"))) inline int32_t avx2_output(const int16_t *acc, const int8_t *weights)
+{
+    static_assert(NNUE_HIDDEN == 32, "the AVX2 output layer handles exactly 32 hidden units");
+    const __m256i ceiling = _mm256_set1_epi16(127);
+    __m256i lo = _mm256_min_epi16(_mm256_load_si256((const __m256i *)acc), ceiling);
+    __m256i hi = _mm256_min_epi16(_mm256_load_si256((const __m256i *)(acc + 16)), ceiling);
+    // packus clamps at 0 and interleaves the 128-bit lanes; the permute restores the order
+    __m256i hidden = _mm256_permute4x64_epi64(_mm256_packus_epi16(lo, hi), 0xD8);
+    __m256i pairs = _mm256_maddubs_epi16(hidden, _mm256_load_si256((const __m256i *)weights));
+    __m256i sums = _mm256_madd_epi16(pairs, _mm256_set1_epi16(1));
+    __m128i s = _mm_add_epi32(_mm256_castsi256_si128(sums), _mm256_extracti128_si256(sums, 1));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0x4E));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0xB1));
+    return _mm_cvtsi128_si32(s);
+}
+
+const NetworkKernels Network_Kernels[] = {
+    {"scalar", always_supported, scalar_update, scalar_output},
+    {"avx2", avx2_supported, avx2_update, avx2_output},
+};
+
+inline const NetworkKernels &network_kernels()
+{
+    static const NetworkKernels &active = avx2_supported() ? Network_Kernels[1] : Network_Kernels[0];
+    return active;
+}
+
+class Network
+{
+private:
+    alignas(32) int16_t feature_weights[NNUE_INPUTS][NNUE_HIDDEN];
+    alignas(32) int16_t hidden_bias[NNUE_HIDDEN];
+    alignas(32) int8_t output_weights[NNUE_HIDDEN];
+    int32_t output_bias;
+    int32_t output_shift;
+
+public:
+    Network() : output_bias(0), output_shift(0)
+    {
+        memset(feature_weights, 0, sizeof(feature_weights));
+        memset(hidden_bias, 0, sizeof(hidden_bias));
+        memset(output_weights, 0, sizeof(output_weights));
+    }
+    // Weight file: "OTNN", uint32 hidden size, then little-endian int16
+    // feature weights [NNUE_INPUTS][NNUE_HIDDEN], int16 hidden bias, int8
+    // output weights, int32 output bias and int32 output shift.
+    bool load(const char *path)
+    {
+        FILE *file = fopen(path, "rb");
+        if (!file)
+            return false;
+        char magic[4];
+        uint32_t hidden = 0;
+        bool ok = fread(magic, 1, 4, file) == 4 && memcmp(magic, "OTNN", 4) == 0 &&
+                  fread(&hidden, sizeof(hidden), 1, file) == 1 && hidden == NNUE_HIDDEN &&
+                  fread(feature_weights, sizeof(feature_weights), 1, file) == 1 &&
+                  fread(hidden_bias, sizeof(hidden_bias), 1, file) == 1 &&
+                  fread(output_weights, sizeof(output_weights), 1, file) == 1 &&
+                  fread(&output_bias, sizeof(output_bias), 1, file) == 1 &&
+                  fread(&output_shift, sizeof(output_shift), 1, file) == 1 &&
+                  0 <= output_shift && output_shift < 32;
+        fclose(file);
+        return ok;
+    }
+    // arbitrary small weights, for measuring speed without a trained file
+    void randomize(uint64_t seed)
+    {
+        for (int i = 0; i < NNUE_INPUTS; i++)
+        {
+            for (int j = 0; j < NNUE_HIDDEN; j++)
+                feature_weights[i][j] = (int16_t)(splitmix64(seed) % 17) - 8;
+        }
+        for (int j = 0; j < NNUE_HIDDEN; j++)
+        {
+            hidden_bias[j] = (int16_t)(splitmix64(seed) % 64);
+            output_weights[j] = (int8_t)(splitmix64(seed) % 65) - 32;
+        }
+        output_bias = 0;
+        output_shift = 6;
+    }
+    void refresh(Accumulator &acc, uint64_t black, uint64_t white) const
+    {
+        memcpy(acc.v, hidden_bias, sizeof(acc.v));
+        for (; black; black &= black - 1)
+            add(acc, nnue_feature(1, __builtin_ctzll(black)));
+        for (; white; white &= white - 1)
+            add(acc, nnue_feature(2, __builtin_ctzll(white)));
+    }
+    void add(Accumulator &acc, int feature) const
+    {
+        network_kernels().update(acc.v, nullptr, feature_weights[feature]);
+    }
+    void sub(Accumulator &acc, int feature) const
+    {
+        network_kernels().update(acc.v, feature_weights[feature], nullptr);
+    }
+    // a disc changing colour: one pass instead of sub and add
+    void replace(Accumulator &acc, int removed, int added) const
+    {
+        network_kernels().update(acc.v, feature_weights[removed], feature_weights[added]);
+    }
+    int evaluate(const Accumulator &acc) const
+    {
+        int32_t total = network_kernels().output(acc.v, output_weights);
+        return (total + output_bias) >> output_shift;
+    }
+};
+
+#endif
@@ -0,0 +1,213 @@
+#ifndef POSITION_IO_H
+#define POSITION_IO_H
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "bitboard.h"
+
+// Compact positions for bulk analysis. The text form is one line per position:
+// 64 characters in board[x][y] order ('X' black, 'O' white, '-' empty), a space
+// and the side to move ("X" or "O"), optionally followed by the chosen move in
+// book notation and its score ("f5 12"). The binary form is a PositionRecord.
+enum POSITION_FORMAT
+{
+    POSITION_TEXT = 0,
+    POSITION_BINARY = 1
+};
+
+// binary when the file name ends in ".bin"
+inline POSITION_FORMAT format_of(const char *path)
+{
+    size_t n = strlen(path);
+    return n >= 4 && strcmp(path + n - 4, ".bin") == 0 ? POSITION_BINARY : POSITION_TEXT;
+}
+
+struct PositionRecord
+{
+    Bitboard black;
+    Bitboard white;
+    uint8_t player; // BLACK = 1, WHITE = 2
+    uint8_t move;   // square index of the chosen move, 0xFF if none
+    int16_t score;
+    uint8_t reserved[4];
+};
+static_assert(sizeof(PositionRecord) == 24, "PositionRecord must stay a fixed-size record");
+
+// Streams positions straight out of a memory-mapped file.
+class PositionReader
+{
+private:
+    const char *data;
+    size_t size, offset;
+    POSITION_FORMAT format;
+
+    bool next_text(PositionRecord &rec)
+    {
+        // skip blank lines
+        while (offset < size && (data[offset] == '\n' || data[offset] == '\r'))
+            offset++;
+        if (size - offset < 66)
+            return false;
+        const char *line = data + offset;
+        rec = PositionRecord();
+        for (int sq = 0; sq < 64; sq++)
+        {
+            switch (line[sq])
+            {
+            case 'X':
+                rec.black |= 1ULL << sq;
+                break;
+            case 'O':
+                rec.white |= 1ULL << sq;
+                break;
+            }
+        }
+        rec.player = line[65] == 'O' ? 2 : 1;
+        rec.move = 0xFF;
+        const char *end = (const char *)memchr(line, '\n', size - offset);
+        size_t length = end ? end - line : size - offset;
+        if (length >= 71 && line[66] == ' ')
+        {
+            rec.move = (line[68] - '1') * 8 + (line[67] - 'a');
+            size_t i = 70;
+            int sign = 1, score = 0;
+            if (i < length && line[i] == '-')
+            {
+                sign = -1;
+                i++;
+            }
+            for (; i < length && '0' <= line[i] && line[i] <= '9'; i++)
+                score = score * 10 + (line[i] - '0');
+            rec.score = (int16_t)(sign * score);
+        }
+        offset = end ? end - data + 1 : size;
+        return true;
+    }
+
+public:
+    PositionReader() : data(nullptr), size(0), offset(0), format(POSITION_TEXT) {}
+    ~PositionReader()
+    {
+        close();
+    }
+    bool open(const char *path, POSITION_FORMAT fmt)
+    {
+        close();
+        int fd = ::open(path, O_RDONLY);
+        if (fd < 0)
+            return false;
+        struct stat st;
+        if (fstat(fd, &st) < 0)
+        {
+            ::close(fd);
+            return false;
+        }
+        size = st.st_size;
+        if (size > 0)
+        {
+            void *mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapped == MAP_FAILED)
+            {
+                ::close(fd);
+                size = 0;
+                return false;
+            }
+            madvise(mapped, size, MADV_SEQUENTIAL);
+            data = (const char *)mapped;
+        }
+        ::close(fd);
+        offset = 0;
+        format = fmt;
+        return true;
+    }
+    void close()
+    {
+        if (data)
+            munmap((void *)data, size);
+        data = nullptr;
+        size = offset = 0;
+    }
+    bool next(PositionRecord &rec)
+    {
+        if (format == POSITION_TEXT)
+            return next_text(rec);
+        if (size - offset < sizeof(PositionRecord))
+            return false;
+        memcpy(&rec, data + offset, sizeof(PositionRecord));
+        offset += sizeof(PositionRecord);
+        return true;
+    }
+};
+
+// Collects output in a large buffer and writes it out in blocks.
+class PositionWriter
+{
+private:
+    FILE *file;
+    POSITION_FORMAT format;
+    std::vector<char> buffer;
+    size_t used;
+
+    void reserve(size_t n)
+    {
+        if (used + n > buffer.size())
+            flush();
+    }
+
+public:
+    PositionWriter() : file(nullptr), format(POSITION_TEXT), buffer(1 << 16), used(0) {}
+    ~PositionWriter()
+    {
+        close();
+    }
+    bool open(const char *path, POSITION_FORMAT fmt)
+    {
+        close();
+        file = fopen(path, fmt == POSITION_BINARY ? "wb" : "w");
+        format = fmt;
+        return file != nullptr;
+    }
+    void flush()
+    {
+        if (file && used > 0)
+            fwrite(buffer.data(), 1, used, file);
+        used = 0;
+    }
+    void close()
+    {
+        flush();
+        if (file)
+            fclose(file);
+        file = nullptr;
+    }
+    void write(const PositionRecord &rec)
+    {
+        if (format == POSITION_BINARY)
+        {
+            reserve(sizeof(PositionRecord));
+            memcpy(buffer.data() + used, &rec, sizeof(PositionRecord));
+            used += sizeof(PositionRecord);
+            return;
+        }
+        reserve(80);
+        char *line = buffer.data() + used;
+        for (int sq = 0; sq < 64; sq++)
+            line[sq] = (rec.black >> sq) & 1 ? 'X' : (rec.white >> sq) & 1 ? 'O' : '-';
+        line[64] = ' ';
+        line[65] = rec.player == 2 ? 'O' : 'X';
+        used += 66;
+        if (rec.move != 0xFF)
+            used += snprintf(line + 66, 14, " %c%c %d", 'a' + rec.move % 8, '1' + rec.move / 8, rec.score);
+        buffer[used++] = '\n';
+    }
+};
+
+#endif
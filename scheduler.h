@@ -0,0 +1,106 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+
+// Shares a fixed number of cores among the searches of many games. Each
+// search runs on its own thread but only holds a core between begin() and
+// end(); the others sleep. Free cores go to the waiting search with the
+// earliest deadline, and a search arriving with an earlier deadline than a
+// running one takes that one's core at its next checkpoint(). A preempted
+// search keeps its whole state on its stack and resumes where it stopped.
+class CoreScheduler
+{
+private:
+    struct Task
+    {
+        double deadline; // ms on the steady clock
+        bool running;
+        bool preempt; // asked to give its core back at the next checkpoint
+    };
+    std::mutex lock;
+    std::condition_variable changed;
+    std::map<const void *, Task> tasks; // by search owner
+    int cores;
+
+    // called with lock held
+    void dispatch()
+    {
+        int running = 0;
+        for (const auto &task : tasks)
+            running += task.second.running;
+        while (true)
+        {
+            Task *next = nullptr;
+            for (auto &task : tasks)
+            {
+                if (!task.second.running && (!next || task.second.deadline < next->deadline))
+                    next = &task.second;
+            }
+            if (!next)
+                break;
+            if (running < cores)
+            {
+                next->running = true;
+                running++;
+                continue;
+            }
+            // no core free: the running search with the latest deadline yields
+            Task *victim = nullptr;
+            for (auto &task : tasks)
+            {
+                Task &t = task.second;
+                if (t.running && !t.preempt && t.deadline > next->deadline && (!victim || t.deadline > victim->deadline))
+                    victim = &t;
+            }
+            if (victim)
+                victim->preempt = true;
+            break;
+        }
+        changed.notify_all();
+    }
+    void wait_for_core(std::unique_lock<std::mutex> &held, const void *owner)
+    {
+        changed.wait(held, [&] { return tasks[owner].running; });
+    }
+
+public:
+    explicit CoreScheduler(int n) : cores(n > 0 ? n : 1) {}
+
+    static double now()
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+    // blocks until the search of owner, due by deadline, has a core
+    void begin(const void *owner, double deadline)
+    {
+        std::unique_lock<std::mutex> held(lock);
+        tasks[owner] = Task{deadline, false, false};
+        dispatch();
+        wait_for_core(held, owner);
+    }
+    // gives the core away if a more urgent search asked for it, and waits
+    // for the next one
+    void checkpoint(const void *owner)
+    {
+        std::unique_lock<std::mutex> held(lock);
+        Task &task = tasks[owner];
+        if (!task.preempt)
+            return;
+        task.preempt = false;
+        task.running = false;
+        dispatch();
+        wait_for_core(held, owner);
+    }
+    void end(const void *owner)
+    {
+        std::lock_guard<std::mutex> held(lock);
+        tasks.erase(owner);
+        dispatch();
+    }
+};
+
+#endif
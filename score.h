@@ -0,0 +1,83 @@
+#ifndef SCORE_H
+#define SCORE_H
+
+#include <algorithm>
+
+#include "transposition.h"
+
+// Search values on one bounded scale, from the engine's side:
+//
+//   -SCORE_INF                    window bound only, never a position's value
+//   -SCORE_WIN - 64 .. -SCORE_WIN - 1   lost by 64 .. 1 discs
+//   -SCORE_HEURISTIC .. SCORE_HEURISTIC heuristic estimates (0 is also a draw)
+//   SCORE_WIN + 1 .. SCORE_WIN + 64     won by 1 .. 64 discs
+//   SCORE_INF                     window bound only
+//
+// Decided games sort by their margin, so the search prefers the bigger win and
+// the smaller loss, and every value fits an int16_t.
+const int SCORE_INF = 30000;
+const int SCORE_WIN = 20000;
+const int SCORE_HEURISTIC = SCORE_WIN - 1;
+
+// final score of a game that ends with the given disc difference
+inline int final_score(int disc_difference)
+{
+    if (disc_difference > 0)
+        return SCORE_WIN + disc_difference;
+    if (disc_difference < 0)
+        return -SCORE_WIN + disc_difference;
+    return 0;
+}
+
+// the smallest win or loss; the win/loss/draw solver never searches the margin
+inline int outcome_score(int disc_difference)
+{
+    return disc_difference > 0 ? SCORE_WIN + 1 : disc_difference < 0 ? -SCORE_WIN - 1 : 0;
+}
+
+inline bool is_win(int value)
+{
+    return value > SCORE_WIN;
+}
+
+inline bool is_loss(int value)
+{
+    return value < -SCORE_WIN;
+}
+
+inline bool is_decided(int value)
+{
+    return is_win(value) || is_loss(value);
+}
+
+// disc difference of a decided value
+inline int disc_margin(int value)
+{
+    return is_win(value) ? value - SCORE_WIN : is_loss(value) ? value + SCORE_WIN : 0;
+}
+
+// keeps an evaluation out of the win and loss bands
+inline int clamp_heuristic(int value)
+{
+    return std::max(-SCORE_HEURISTIC, std::min(SCORE_HEURISTIC, value));
+}
+
+// Window helpers: a value at or above beta (below or at alpha) is only a
+// bound, the true value lies on that side of it.
+inline bool fails_high(int value, int beta)
+{
+    return value >= beta;
+}
+
+inline bool fails_low(int value, int alpha)
+{
+    return value <= alpha;
+}
+
+// the transposition flag for a value searched in the window (alpha, beta)
+inline int bound_flag(int value, int alpha, int beta)
+{
+    return fails_low(value, alpha) ? TT_UPPER : fails_high(value, beta) ? TT_LOWER : TT_EXACT;
+}
+
+#endif
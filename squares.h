@@ -0,0 +1,64 @@
+#ifndef SQUARES_H
+#define SQUARES_H
+
+#include <cstdint>
+
+#include "bitboard.h"
+
+// a move or board position encoded as the square index x * 8 + y
+typedef uint8_t Square;
+
+constexpr Square to_square(int x, int y)
+{
+    return x * 8 + y;
+}
+constexpr int square_x(Square sq)
+{
+    return sq >> 3;
+}
+constexpr int square_y(Square sq)
+{
+    return sq & 7;
+}
+// board quadrant 0..3, the regions tracked for endgame parity
+constexpr int quadrant(Square sq)
+{
+    return (square_x(sq) >> 2) * 2 + (square_y(sq) >> 2);
+}
+
+struct SquareTables
+{
+    // squares walked from a square towards each direction, nearest first
+    Square ray[64][8][7];
+    // number of squares between a square and the edge in each direction
+    uint8_t edge_distance[64][8];
+    // adjacent squares
+    Bitboard neighbors[64];
+};
+
+constexpr SquareTables make_square_tables()
+{
+    SquareTables t{};
+    const int dx[8] = {-1, -1, -1, 0, 0, 1, 1, 1};
+    const int dy[8] = {-1, 0, 1, -1, 1, -1, 0, 1};
+    for (int sq = 0; sq < 64; sq++)
+    {
+        for (int d = 0; d < 8; d++)
+        {
+            int x = sq / 8 + dx[d], y = sq % 8 + dy[d], n = 0;
+            while (0 <= x && x < 8 && 0 <= y && y < 8)
+            {
+                t.ray[sq][d][n++] = x * 8 + y;
+                x += dx[d];
+                y += dy[d];
+            }
+            t.edge_distance[sq][d] = n;
+            if (n > 0)
+                t.neighbors[sq] |= 1ULL << t.ray[sq][d][0];
+        }
+    }
+    return t;
+}
+constexpr SquareTables Square_Tables = make_square_tables();
+
+#endif
@@ -0,0 +1,202 @@
+#ifndef STATE_H
+#define STATE_H
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "bitboard.h"
+#include "transposition.h"
+#include "squares.h"
+#include "move_list.h"
+#include "movegen.h"
+#include "nnue.h"
+
+#define ENDGAME_EMPTIES 22
+#define SYMMETRY_HASH false // the transposition table shares entries between the 8 orientations
+
+enum SPOT_STATE
+{
+    EMPTY = 0,
+    BLACK = 1,
+    WHITE = 2
+};
+const int SIZE = 8;
+// ordering bonus for endgame moves into a quadrant with an odd number of empties
+const int PARITY_ORDER = 32;
+
+// the board as the game host writes it, board[x][y]
+typedef std::array<std::array<int, SIZE>, SIZE> Grid;
+// static square values that order moves
+typedef std::array<int, SIZE * SIZE> ScoreTable;
+
+class State
+{
+public:
+    std::array<int, SIZE * SIZE> board;
+    MoveList next_valid_spots;
+    std::array<int, 3> disc_count;
+    std::array<Bitboard, 3> discs; // the board again as one bitboard per disc
+    int cur_player;
+    uint64_t hash;
+    uint8_t parity;          // bit q set while quadrant q has an odd number of empties
+    Accumulator accumulator; // first network layer, maintained only with a network
+    const ScoreTable *scores;
+    const Network *network; // nullptr when evaluating without one
+    const TranspositionTable *table; // prefetched for each new position, if given
+
+public:
+    int get_next_player(int player) const
+    {
+        return 3 - player;
+    }
+    int get_disc(Square sq) const
+    {
+        return board[sq];
+    }
+    void set_disc(Square sq, int disc)
+    {
+        hash ^= Zobrist.square[sq][board[sq]] ^ Zobrist.square[sq][disc];
+        if (network)
+        {
+            if (board[sq] == EMPTY)
+                network->add(accumulator, nnue_feature(disc, sq));
+            else
+                network->replace(accumulator, nnue_feature(board[sq], sq), nnue_feature(disc, sq));
+        }
+        discs[board[sq]] ^= 1ULL << sq;
+        discs[disc] |= 1ULL << sq;
+        board[sq] = disc;
+    }
+    Bitboard get_bitboard(int disc) const
+    {
+        return discs[disc];
+    }
+    void flip_discs(Square center)
+    {
+        int opponent = get_next_player(cur_player);
+        Bitboard flipped = move_generator().flips(discs[cur_player], discs[opponent], center);
+        int k = bit_count(flipped);
+        for (; flipped; flipped &= flipped - 1)
+            set_disc(__builtin_ctzll(flipped), cur_player);
+        disc_count[cur_player] += k;
+        disc_count[opponent] -= k;
+    }
+
+public:
+    State(const Grid &start_board, int player, const ScoreTable &score_table, const Network *net = nullptr, const TranspositionTable *tt = nullptr)
+        : discs(), cur_player(player), hash(player == WHITE ? Zobrist.side : 0), parity(0), scores(&score_table), network(net), table(tt)
+    {
+        int E = 0, B = 0, W = 0;
+        for (int i = 0; i < SIZE; i++)
+        {
+            for (int j = 0; j < SIZE; j++)
+            {
+                Square sq = to_square(i, j);
+                board[sq] = start_board[i][j];
+                hash ^= Zobrist.square[sq][board[sq]];
+                discs[board[sq]] |= 1ULL << sq;
+                switch (board[sq])
+                {
+                case EMPTY:
+                    E++;
+                    parity ^= 1 << quadrant(sq);
+                    break;
+                case BLACK:
+                    B++;
+                    break;
+                case WHITE:
+                    W++;
+                    break;
+                }
+            }
+        }
+        disc_count[EMPTY] = E;
+        disc_count[BLACK] = B;
+        disc_count[WHITE] = W;
+
+        if (network)
+            network->refresh(accumulator, get_bitboard(BLACK), get_bitboard(WHITE));
+        next_valid_spots = get_valid_spots();
+    }
+    // the legal moves as the game host lists them
+    State(const Grid &start_board, int player, const std::vector<Square> &valid_spots, const ScoreTable &score_table, const Network *net = nullptr, const TranspositionTable *tt = nullptr)
+        : State(start_board, player, score_table, net, tt)
+    {
+        next_valid_spots.clear();
+        for (Square sq : valid_spots)
+            next_valid_spots.push(sq, score_table[sq]);
+    }
+    State(const State &rhs)
+        : board(rhs.board), discs(rhs.discs), cur_player(rhs.cur_player), hash(rhs.hash), parity(rhs.parity),
+          accumulator(rhs.accumulator), scores(rhs.scores), network(rhs.network), table(rhs.table)
+    {
+        disc_count[EMPTY] = rhs.disc_count[EMPTY];
+        disc_count[BLACK] = rhs.disc_count[BLACK];
+        disc_count[WHITE] = rhs.disc_count[WHITE];
+
+        next_valid_spots = rhs.next_valid_spots;
+    }
+    MoveList get_valid_spots() const
+    {
+        MoveList valid_spots;
+        Bitboard legal = move_generator().legal(discs[cur_player], discs[get_next_player(cur_player)]);
+        for (; legal; legal &= legal - 1)
+        {
+            Square sq = __builtin_ctzll(legal);
+            int score = (*scores)[sq];
+            if (disc_count[EMPTY] <= ENDGAME_EMPTIES && (parity >> quadrant(sq) & 1))
+                score += PARITY_ORDER;
+            valid_spots.push(sq, score);
+        }
+        return valid_spots;
+    }
+    bool put_disc(Square sq)
+    {
+        set_disc(sq, cur_player);
+        disc_count[cur_player]++;
+        disc_count[EMPTY]--;
+        parity ^= 1 << quadrant(sq);
+        flip_discs(sq);
+        // Give control to the other player.
+        cur_player = get_next_player(cur_player);
+        hash ^= Zobrist.side;
+        // the search probes this position next; overlap the miss with move generation
+        prefetch_table();
+        next_valid_spots = get_valid_spots();
+        return true;
+    }
+    bool pass()
+    {
+        // Give control to the other player.
+        cur_player = get_next_player(cur_player);
+        hash ^= Zobrist.side;
+        prefetch_table();
+        next_valid_spots = get_valid_spots();
+        return true;
+    }
+    void prefetch_table() const;
+};
+
+// Key of the position in the transposition table and the book. When symmetric,
+// all 8 orientations share the key of the canonical one and sym maps this
+// position onto it.
+inline uint64_t position_key(const State &curState, bool symmetric, int &sym)
+{
+    sym = 0;
+    if (!symmetric)
+        return curState.hash;
+    Bitboard black = curState.get_bitboard(BLACK), white = curState.get_bitboard(WHITE);
+    canonical(black, white, sym);
+    return hash_bitboards(black, white) ^ (curState.cur_player == WHITE ? Zobrist.side : 0);
+}
+
+// the bucket the search's probe will read: the same key, canonical or not
+inline void State::prefetch_table() const
+{
+    int sym;
+    if (table)
+        table->prefetch(position_key(*this, SYMMETRY_HASH, sym));
+}
+
+#endif
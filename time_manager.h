@@ -0,0 +1,96 @@
+#ifndef TIME_MANAGER_H
+#define TIME_MANAGER_H
+
+#include <algorithm>
+#include <chrono>
+
+// Splits the game clock into a soft limit, after which no new iteration is
+// started, and a hard limit, at which a running search is aborted.
+class TimeManager
+{
+private:
+    std::chrono::steady_clock::time_point start;
+    double soft, hard, limit; // milliseconds; limit bounds any extension
+    bool active;
+
+public:
+    // safety margin kept on the clock for process start-up and output
+    static constexpr double OVERHEAD = 30;
+
+    TimeManager() : soft(0), hard(0), limit(0), active(false) {}
+
+    // remaining and increment describe the game clock, move_cap a fixed
+    // per-move limit; pass 0 for the ones that do not apply. With neither,
+    // the search is not limited by time at all.
+    void start_move(double remaining, double increment, double move_cap, int empties)
+    {
+        start = std::chrono::steady_clock::now();
+        active = remaining > 0 || move_cap > 0;
+        if (!active)
+            return;
+        if (remaining > 0)
+        {
+            // our share of the remaining moves, weighted towards the midgame
+            double moves_left = std::max(2, (empties + 1) / 2);
+            double usable = std::max(0.0, remaining - OVERHEAD);
+            soft = usable / moves_left + increment * 0.8;
+            if (empties > 40)
+                soft *= 0.7;
+            else if (empties > 18)
+                soft *= 1.3;
+            hard = std::min(soft * 4, usable * 0.25 + increment * 0.8);
+            soft = std::min(soft, hard);
+        }
+        else
+        {
+            soft = hard = move_cap;
+        }
+        if (move_cap > 0)
+        {
+            hard = std::min(hard, std::max(0.0, move_cap - OVERHEAD));
+            soft = std::min(soft, hard * 0.5);
+        }
+        limit = hard;
+    }
+    void stop()
+    {
+        active = false;
+    }
+    bool is_active() const
+    {
+        return active;
+    }
+    double elapsed() const
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+    // the next iteration takes about branching times the previous ones
+    bool should_start_iteration(double branching = 2.5) const
+    {
+        if (!active)
+            return true;
+        double used = elapsed();
+        return used < soft && used * branching < hard;
+    }
+    // the most this move may take, in milliseconds
+    double hard_limit() const
+    {
+        return hard;
+    }
+    bool hard_expired() const
+    {
+        return active && elapsed() >= hard;
+    }
+    // more time when the best move changed late or the score dropped
+    void extend(double factor)
+    {
+        soft = std::min(limit, soft * factor);
+    }
+    // less time when one move keeps dominating
+    void shorten(double factor)
+    {
+        soft *= factor;
+    }
+};
+
+#endif
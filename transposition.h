@@ -0,0 +1,245 @@
+#ifndef TRANSPOSITION_H
+#define TRANSPOSITION_H
+
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cstdint>
+#include <vector>
+
+inline uint64_t splitmix64(uint64_t &seed)
+{
+    uint64_t z = (seed += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// Zobrist keys per square and disc (EMPTY hashes to 0), plus the side to move
+struct ZobristKeys
+{
+    uint64_t square[64][3];
+    uint64_t side;
+    ZobristKeys()
+    {
+        uint64_t seed = 20220601;
+        for (int i = 0; i < 64; i++)
+        {
+            square[i][0] = 0;
+            square[i][1] = splitmix64(seed);
+            square[i][2] = splitmix64(seed);
+        }
+        side = splitmix64(seed);
+    }
+};
+const ZobristKeys Zobrist;
+
+inline uint64_t hash_bitboards(uint64_t black, uint64_t white)
+{
+    uint64_t seed = black;
+    uint64_t h = splitmix64(seed);
+    seed = white ^ h;
+    return splitmix64(seed);
+}
+
+enum TT_FLAG
+{
+    TT_EXACT = 0,
+    TT_LOWER = 1,
+    TT_UPPER = 2
+};
+const uint8_t NO_MOVE = 0xFF;
+
+// 8 bytes: the key bits above the bucket index are checked through the top
+// 32, the rest are implied by the bucket.
+struct TTEntry
+{
+    uint32_t check; // key >> 32
+    int16_t value;
+    uint8_t move;      // square index x * 8 + y, NO_MOVE if unknown
+    uint8_t depth : 6; // 0 marks an empty slot; stored searches are at least 1 deep
+    uint8_t flag : 2;
+};
+
+// One cache line: 7 entries and the search generation that last wrote or hit
+// each of them.
+struct alignas(64) TTBucket
+{
+    TTEntry entries[7];
+    uint8_t age[7];
+    uint8_t unused;
+};
+static_assert(sizeof(TTBucket) == 64, "a bucket must fill exactly one cache line");
+
+// Bucketed table of search results, 2^bits buckets of 64 bytes. A store
+// replaces the entry of the same position, else an empty one, else the one
+// whose depth, less TT_AGE_WEIGHT per search since it was last used, is
+// lowest, so deep results outlive shallow ones until they go stale.
+const int TT_AGE_WEIGHT = 4;
+
+class TranspositionTable
+{
+private:
+    std::vector<TTBucket> buckets;
+    uint64_t mask;
+    uint8_t generation;
+
+public:
+    explicit TranspositionTable(int bits)
+        : buckets(1ULL << bits, TTBucket{}), mask((1ULL << bits) - 1), generation(0)
+    {
+    }
+    // forgets every entry, e.g. when the values stored change meaning
+    void clear()
+    {
+        std::fill(buckets.begin(), buckets.end(), TTBucket{});
+    }
+    // entries not touched from now on age by one
+    void new_search()
+    {
+        generation++;
+    }
+    // start loading the bucket of key ahead of its probe or store
+    void prefetch(uint64_t key) const
+    {
+        __builtin_prefetch(&buckets[key & mask]);
+    }
+    const TTEntry *probe(uint64_t key)
+    {
+        TTBucket &bucket = buckets[key & mask];
+        uint32_t check = key >> 32;
+        for (int i = 0; i < 7; i++)
+        {
+            if (bucket.entries[i].check == check && bucket.entries[i].depth)
+            {
+                bucket.age[i] = generation;
+                return &bucket.entries[i];
+            }
+        }
+        return nullptr;
+    }
+    void store(uint64_t key, int depth, int value, int flag, uint8_t move)
+    {
+        TTBucket &bucket = buckets[key & mask];
+        uint32_t check = key >> 32;
+        int victim = 0, victim_worth = INT32_MAX;
+        for (int i = 0; i < 7; i++)
+        {
+            const TTEntry &entry = bucket.entries[i];
+            if (entry.check == check && entry.depth)
+            {
+                // a result without a move keeps the one found earlier
+                if (move == NO_MOVE)
+                    move = entry.move;
+                victim = i;
+                break;
+            }
+            int worth = entry.depth ? entry.depth - TT_AGE_WEIGHT * (uint8_t)(generation - bucket.age[i]) : INT32_MIN;
+            if (worth < victim_worth)
+            {
+                victim = i;
+                victim_worth = worth;
+            }
+        }
+        TTEntry &entry = bucket.entries[victim];
+        entry.check = check;
+        entry.value = (int16_t)value;
+        entry.move = move;
+        entry.depth = depth;
+        entry.flag = flag;
+        bucket.age[victim] = generation;
+    }
+};
+
+struct EvalEntry
+{
+    uint64_t key;
+    int32_t value;
+    int32_t player; // side the value is scored for, 0 if empty
+};
+
+// Direct-mapped, always-replace cache of leaf evaluations, kept apart from the
+// transposition table so cheap leaf entries never evict search results.
+// bits = 0 disables it.
+class EvalCache
+{
+private:
+    std::vector<EvalEntry> entries;
+    uint64_t mask;
+
+public:
+    uint64_t hits, misses;
+
+    explicit EvalCache(int bits) : mask(0), hits(0), misses(0)
+    {
+        resize(bits);
+    }
+    void resize(int bits)
+    {
+        entries.assign(bits > 0 ? 1ULL << bits : 0, EvalEntry{0, 0, 0});
+        mask = bits > 0 ? (1ULL << bits) - 1 : 0;
+    }
+    bool probe(uint64_t key, int player, int &value)
+    {
+        if (entries.empty())
+            return false;
+        const EvalEntry &entry = entries[key & mask];
+        if (entry.key != key || entry.player != player)
+        {
+            misses++;
+            return false;
+        }
+        hits++;
+        value = entry.value;
+        return true;
+    }
+    void store(uint64_t key, int player, int value)
+    {
+        if (!entries.empty())
+            entries[key & mask] = EvalEntry{key, value, player};
+    }
+    double hit_rate() const
+    {
+        return hits + misses > 0 ? (double)hits / (hits + misses) : 0;
+    }
+};
+
+// Table for the parallel endgame solver, shared by its threads without locks.
+// An entry is a single 64-bit word (key bits 63..16, move 15..8, valid bit 4,
+// flag 3..2, outcome 1..0), so a reader sees a whole entry or none of it.
+// Outcomes are 0 loss, 1 draw, 2 win.
+class SolveTable
+{
+private:
+    std::vector<std::atomic<uint64_t>> entries;
+    uint64_t mask;
+
+public:
+    explicit SolveTable(int bits) : entries(1ULL << bits), mask((1ULL << bits) - 1)
+    {
+        for (std::atomic<uint64_t> &entry : entries)
+            entry.store(0, std::memory_order_relaxed);
+    }
+    bool probe(uint64_t key, int &outcome, int &flag, uint8_t &move) const
+    {
+        uint64_t entry = entries[key & mask].load(std::memory_order_relaxed);
+        if (!(entry & 16) || (entry ^ key) >> 16)
+            return false;
+        outcome = entry & 3;
+        flag = (entry >> 2) & 3;
+        move = (entry >> 8) & 0xFF;
+        return true;
+    }
+    void store(uint64_t key, int outcome, int flag, uint8_t move)
+    {
+        uint64_t entry = (key & ~0xFFFFULL) | (uint64_t)move << 8 | 16 | flag << 2 | outcome;
+        entries[key & mask].store(entry, std::memory_order_relaxed);
+    }
+    void clear()
+    {
+        for (std::atomic<uint64_t> &entry : entries)
+            entry.store(0, std::memory_order_relaxed);
+    }
+};
+
+#endif